@@ -0,0 +1,213 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include "Constants.h"
+using namespace std;
+using namespace Constants;
+
+// File to count heap allocations per frame, per pattern, and per subsystem tag. Only compiled in when SHOOTEMUP_ALLOCTRACK
+// is defined, which replaces the global operator new and delete. That replacement is defined in this header, so it must
+// only be included by one translation unit per program, as every target here is.
+// ALLOC_SCOPE(tag) counts allocations in the rest of the enclosing block under a tag from ALLOCTAGLABELS, and
+// ALLOC_PATTERN_SCOPE(tag, index) also counts them against a pattern, ALLOC_END_FRAME() closes a frame, and
+// ALLOC_WRITE_REPORT(path, patternCount) writes the totals of the run. Without SHOOTEMUP_ALLOCTRACK the macros compile to nothing
+
+// Counters of one tag or pattern. Relaxed atomics so any thread can allocate
+struct AllocCounters {
+	atomic<long long> allocations{ 0 }, frees{ 0 }, bytesAllocated{ 0 }, bytesFreed{ 0 };
+};
+
+// Allocations of one frame, or the totals of every frame
+struct AllocFrameStats {
+	long long allocations = 0, frees = 0, bytes = 0;
+};
+
+// Every counter is static and constant initialized, so allocations made before main are counted safely.
+// Nothing here may allocate while counting
+class AllocTracker {
+	static inline AllocCounters tags[ALLOCTAGCOUNT];
+	static inline AllocCounters patterns[MAXTRACKEDPATTERNS];
+	static inline thread_local int currentTag = ALLOCOTHER;
+	static inline thread_local int currentPattern = -1;
+	// Frame accounting, only touched by the thread calling endFrame
+	static inline AllocFrameStats countedAtFrameStart, lastFrame, worstFrame;
+	static inline long long frames = 0, framesWithAllocations = 0, lastFrameWithAllocations = -1, worstFrameIndex = -1;
+
+	// Allocations and frees that count against frames. UI allocations are left out
+	static AllocFrameStats getFrameCounted() {
+		AllocFrameStats counted;
+		for (int i = 0; i < ALLOCTAGCOUNT; i++) {
+			if (i == ALLOCUI)
+				continue;
+			counted.allocations += tags[i].allocations.load(memory_order_relaxed);
+			counted.frees += tags[i].frees.load(memory_order_relaxed);
+			counted.bytes += tags[i].bytesAllocated.load(memory_order_relaxed);
+		}
+		return counted;
+	}
+	static void writeCounters(ofstream& file, const string& label, const AllocCounters& counters) {
+		file << label << "\t" << counters.allocations.load(memory_order_relaxed) << "\t" << counters.frees.load(memory_order_relaxed)
+			<< "\t" << counters.bytesAllocated.load(memory_order_relaxed) << "\t" << counters.bytesFreed.load(memory_order_relaxed) << "\n";
+	}
+public:
+	// Tag and pattern of the calling thread. Thread pool chunks run under the context of the thread that queued them
+	struct Context {
+		int tag, pattern;
+	};
+	static Context getContext() {
+		return { currentTag, currentPattern };
+	}
+	static void setContext(Context context) {
+		currentTag = context.tag;
+		currentPattern = context.pattern;
+	}
+	static void recordAllocation(size_t size) {
+		AllocCounters& tag = tags[currentTag];
+		tag.allocations.fetch_add(1, memory_order_relaxed);
+		tag.bytesAllocated.fetch_add(size, memory_order_relaxed);
+		if (currentPattern >= 0 && currentPattern < MAXTRACKEDPATTERNS) {
+			patterns[currentPattern].allocations.fetch_add(1, memory_order_relaxed);
+			patterns[currentPattern].bytesAllocated.fetch_add(size, memory_order_relaxed);
+		}
+	}
+	// Frees count against whatever freed the block, not whatever allocated it
+	static void recordFree(size_t size) {
+		AllocCounters& tag = tags[currentTag];
+		tag.frees.fetch_add(1, memory_order_relaxed);
+		tag.bytesFreed.fetch_add(size, memory_order_relaxed);
+		if (currentPattern >= 0 && currentPattern < MAXTRACKEDPATTERNS) {
+			patterns[currentPattern].frees.fetch_add(1, memory_order_relaxed);
+			patterns[currentPattern].bytesFreed.fetch_add(size, memory_order_relaxed);
+		}
+	}
+	// Call once per frame from one thread. Closes the current frame and starts the next
+	static void endFrame() {
+		AllocFrameStats counted = getFrameCounted();
+		lastFrame.allocations = counted.allocations - countedAtFrameStart.allocations;
+		lastFrame.frees = counted.frees - countedAtFrameStart.frees;
+		lastFrame.bytes = counted.bytes - countedAtFrameStart.bytes;
+		countedAtFrameStart = counted;
+		if (lastFrame.allocations > 0) {
+			framesWithAllocations++;
+			lastFrameWithAllocations = frames;
+		}
+		if (worstFrameIndex < 0 || lastFrame.allocations > worstFrame.allocations) {
+			worstFrame = lastFrame;
+			worstFrameIndex = frames;
+		}
+		frames++;
+	}
+	static const AllocFrameStats& getLastFrame() {
+		return lastFrame;
+	}
+	static long long getFrameCount() {
+		return frames;
+	}
+	static long long getFramesWithAllocations() {
+		return framesWithAllocations;
+	}
+	// Write frame statistics and the totals of every tag and pattern. Returns false if the file cannot be opened
+	static bool writeReport(const string& path, int patternCount) {
+		ofstream file(path);
+		if (!file)
+			return false;
+		file << "frames\t" << frames << "\n";
+		file << "frames with allocations\t" << framesWithAllocations << "\n";
+		file << "last frame with allocations\t" << lastFrameWithAllocations << "\n";
+		file << "most allocations in a frame\t" << worstFrame.allocations << " (" << worstFrame.bytes << " bytes, frame " << worstFrameIndex << ")\n";
+		file << "\ntag\tallocations\tfrees\tbytes allocated\tbytes freed\n";
+		for (int i = 0; i < ALLOCTAGCOUNT; i++)
+			writeCounters(file, ALLOCTAGLABELS[i], tags[i]);
+		file << "\npattern\tallocations\tfrees\tbytes allocated\tbytes freed\n";
+		for (int i = 0; i < min(patternCount, MAXTRACKEDPATTERNS); i++)
+			writeCounters(file, i < PATTERNNAMES.size() ? PATTERNNAMES[i] : to_string(i), patterns[i]);
+		return true;
+	}
+};
+
+// Counts allocations under a tag, and optionally a pattern, until the end of the enclosing block
+class AllocScope {
+	AllocTracker::Context previous;
+public:
+	AllocScope(int tag) {
+		previous = AllocTracker::getContext();
+		AllocTracker::setContext({ tag, previous.pattern });
+	}
+	AllocScope(int tag, int pattern) {
+		previous = AllocTracker::getContext();
+		AllocTracker::setContext({ tag, pattern });
+	}
+	AllocScope(AllocTracker::Context context) {
+		previous = AllocTracker::getContext();
+		AllocTracker::setContext(context);
+	}
+	~AllocScope() {
+		AllocTracker::setContext(previous);
+	}
+};
+
+#ifdef SHOOTEMUP_ALLOCTRACK
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+#define ALLOC_SCOPE(tag) AllocScope ALLOC_CONCAT(allocScope, __LINE__)(tag)
+#define ALLOC_PATTERN_SCOPE(tag, pattern) AllocScope ALLOC_CONCAT(allocScope, __LINE__)(tag, pattern)
+#define ALLOC_END_FRAME() AllocTracker::endFrame()
+#define ALLOC_WRITE_REPORT(path, patternCount) AllocTracker::writeReport(path, patternCount)
+
+// Every block starts with a header holding its size so frees can count bytes. Over-aligned allocations keep the standard
+// operators and are not counted
+const size_t ALLOCHEADERSIZE = alignof(max_align_t);
+
+void* operator new(size_t size) {
+	void* block = malloc(size + ALLOCHEADERSIZE);
+	if (!block)
+		throw bad_alloc();
+	*static_cast<size_t*>(block) = size;
+	AllocTracker::recordAllocation(size);
+	return static_cast<char*>(block) + ALLOCHEADERSIZE;
+}
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+void* operator new(size_t size, const nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	}
+	catch (const bad_alloc&) {
+		return nullptr;
+	}
+}
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+	return operator new(size, nothrow);
+}
+void operator delete(void* pointer) noexcept {
+	if (!pointer)
+		return;
+	char* block = static_cast<char*>(pointer) - ALLOCHEADERSIZE;
+	AllocTracker::recordFree(*reinterpret_cast<size_t*>(block));
+	free(block);
+}
+void operator delete[](void* pointer) noexcept {
+	operator delete(pointer);
+}
+void operator delete(void* pointer, size_t) noexcept {
+	operator delete(pointer);
+}
+void operator delete[](void* pointer, size_t) noexcept {
+	operator delete(pointer);
+}
+void operator delete(void* pointer, const nothrow_t&) noexcept {
+	operator delete(pointer);
+}
+void operator delete[](void* pointer, const nothrow_t&) noexcept {
+	operator delete(pointer);
+}
+#else
+#define ALLOC_SCOPE(tag) ((void)0)
+#define ALLOC_PATTERN_SCOPE(tag, pattern) ((void)0)
+#define ALLOC_END_FRAME() ((void)0)
+#define ALLOC_WRITE_REPORT(path, patternCount) false
+#endif
@@ -0,0 +1,109 @@
+// Times each simulation phase of every pattern and prints the results as JSON
+// Usage: ShootEmUpBenchmark [frames] [seed] [output file]
+// Runs the same frames with the same seed every time so results can be compared between builds
+#include <iostream>
+#include <fstream>
+#include <SFML/Graphics.hpp>
+#include <SFML/Audio.hpp>
+#include <numeric>
+#include <cmath>
+#include <chrono>
+#include "Constants.h"
+#include "Drawings.h"
+#include "Mechanisms.h"
+#include "ThreadPool.h"
+#include "Collision.h"
+#include "Bullet.h"
+#include "Pattern.h"
+using namespace std;
+using namespace Constants;
+
+// Phases of a frame, in the order PatternManager::update runs them. Collision includes binning bullets into the grid
+const vector<string> PHASENAMES = { "deleteOutOfBounds", "spawn", "movement", "collision" };
+
+struct PatternResult {
+    string name;
+    vector<long long> phaseNs; // Total time of each phase
+    int peakBullets;
+    long long bulletFrames; // Sum of bullet counts over every frame
+    int hitFrames;
+};
+
+// Run one pattern on its own and time each phase separately
+PatternResult runPattern(int patternIndex, int frames, uint64_t seed) {
+    PatternManager manager(seed);
+    addStandardPatterns(manager);
+    Pattern* pattern = manager[patternIndex];
+    pattern->setActive(true);
+    SfCircleAtHome hitbox(WHITE, PLAYERHITBOXRADIUS, PLAYERSTARTPOS, true);
+
+    PatternResult result = { PATTERNNAMES[patternIndex], vector<long long>(PHASENAMES.size()), 0, 0, 0 };
+    for (int frame = 0; frame < frames; frame++) {
+        auto t0 = chrono::steady_clock::now();
+        pattern->deleteOutOfBoundsBullets();
+        auto t1 = chrono::steady_clock::now();
+        pattern->spawnBullets();
+        pattern->incrementFrame();
+        auto t2 = chrono::steady_clock::now();
+        pattern->processMovement();
+        auto t3 = chrono::steady_clock::now();
+        pattern->binBullets();
+        bool hit = manager.checkPlayerCollision(hitbox);
+        auto t4 = chrono::steady_clock::now();
+
+        result.phaseNs[0] += chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count();
+        result.phaseNs[1] += chrono::duration_cast<chrono::nanoseconds>(t2 - t1).count();
+        result.phaseNs[2] += chrono::duration_cast<chrono::nanoseconds>(t3 - t2).count();
+        result.phaseNs[3] += chrono::duration_cast<chrono::nanoseconds>(t4 - t3).count();
+        int bullets = pattern->getBullets().size();
+        result.peakBullets = max(result.peakBullets, bullets);
+        result.bulletFrames += bullets;
+        result.hitFrames += hit;
+    }
+    return result;
+}
+
+void writeJson(ostream& out, const vector<PatternResult>& results, int frames, uint64_t seed) {
+    out << "{\n";
+    out << "  \"frames\": " << frames << ",\n";
+    out << "  \"seed\": " << seed << ",\n";
+    out << "  \"patterns\": [\n";
+    for (int i = 0; i < results.size(); i++) {
+        const PatternResult& result = results[i];
+        long long totalNs = accumulate(result.phaseNs.begin(), result.phaseNs.end(), 0LL);
+        out << "    {\n";
+        out << "      \"name\": \"" << result.name << "\",\n";
+        out << "      \"peakBullets\": " << result.peakBullets << ",\n";
+        out << "      \"averageBullets\": " << (frames > 0 ? double(result.bulletFrames) / frames : 0) << ",\n";
+        out << "      \"hitFrames\": " << result.hitFrames << ",\n";
+        out << "      \"nsPerFrame\": {\n";
+        for (int phase = 0; phase < PHASENAMES.size(); phase++)
+            out << "        \"" << PHASENAMES[phase] << "\": " << (frames > 0 ? result.phaseNs[phase] / frames : 0) << ",\n";
+        out << "        \"total\": " << (frames > 0 ? totalNs / frames : 0) << "\n";
+        out << "      }\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : 3000;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : 0;
+
+    vector<PatternResult> results;
+    for (int i = 1; i < PATTERNNAMES.size(); i++) // Skip the test pattern
+        results.push_back(runPattern(i, frames, seed));
+
+    if (argc > 3) {
+        ofstream file(argv[3]);
+        if (!file) {
+            cout << "Failed to open " << argv[3] << "\n";
+            return 1;
+        }
+        writeJson(file, results, frames, seed);
+    }
+    else
+        writeJson(cout, results, frames, seed);
+    return 0;
+}
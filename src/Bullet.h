@@ -1,245 +1,664 @@
 #pragma once
+#include <complex>
+#include "Trace.h"
+#include "AllocTracker.h"
 
 // File to contain all bullet implementation
 
-// Game projectiles
-class Bullet : public sf::Drawable { // Abstract base class
-protected:
-	sf::Shape* sprite; // Base sprite. Faces right by default (rotation 0).
-	char flag; // Flag code that will be used for various purposes
-	float xVelocity, yVelocity;
-	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
-		target.draw(*sprite, states);
+// Keep rotation within [0, 360) to match sf::Transformable
+inline float normalizeAngle(float angleDegrees) {
+	angleDegrees = fmod(angleDegrees, 360.f);
+	if (angleDegrees < 0)
+		angleDegrees += 360.f;
+	return angleDegrees;
+}
+// Rotation factor (cos, sin) of an angle. Compute it once and apply it to many bullets with Bullet::rotateBullet
+inline sf::Vector2f getRotationFactor(float angleDegrees) {
+	return sf::Vector2f(cos(angleDegrees * PI / 180), sin(angleDegrees * PI / 180));
+}
+// Rotation factor that turns a bullet moving at speed along a circle of the target radius.
+// Positive speed for clockwise rotation, negative for counterclockwise
+inline sf::Vector2f getArcRotationFactor(float targetRadius, float speed) {
+	if (speed == 0 || targetRadius == 0)
+		return sf::Vector2f(1, 0);
+	return getRotationFactor(speed * 360 / (2 * PI * targetRadius));
+}
+
+// FNV-1a hash of raw bytes, continuing from a previous hash. Used for replay checksums, so it must not change between builds
+inline uint32_t hashBytes(uint32_t hash, const void* bytes, size_t size) {
+	const unsigned char* byte = static_cast<const unsigned char*>(bytes);
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ byte[i]) * 16777619u;
+	return hash;
+}
+template <typename T>
+uint32_t hashVector(uint32_t hash, const vector<T>& values) {
+	return hashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+// Structure-of-arrays storage for bullet attributes. Every array has one entry per bullet, so a pattern's
+// per-frame loops walk contiguous memory instead of chasing a pointer per bullet.
+struct BulletData {
+	vector<float> posX, posY;
+	vector<float> prevX, prevY; // Position at the start of the current tick. Drawing interpolates from here
+	// Velocity is direction times speed. The direction is kept at unit length and is also the sprite orientation,
+	// which faces right by default. It is kept when the speed is zero
+	vector<float> dirX, dirY;
+	vector<float> speeds;
+	vector<float> hitboxRadii; // Used for collision detection
+	vector<char> flags; // Flag code that will be used for various purposes
+	vector<char> types; // Bullet type constant. See Constants.h
+	vector<short> styles; // Index of the sprite style used to draw the bullet
+
+	int size() const {
+		return posX.size();
 	}
-public:
-	Bullet(float speed = 0, float angleDegrees = 0) {
-		sprite = nullptr;
-		xVelocity = speed * cos(angleDegrees * PI / 180);
-		yVelocity = speed * sin(angleDegrees * PI / 180);
-		flag = NEUTRAL;
+	int capacity() const {
+		return posX.capacity();
 	}
-	~Bullet() {
-		delete sprite;
+	// Grow every array to the same capacity in one step
+	void reserve(int capacity) {
+		posX.reserve(capacity);
+		posY.reserve(capacity);
+		prevX.reserve(capacity);
+		prevY.reserve(capacity);
+		dirX.reserve(capacity);
+		dirY.reserve(capacity);
+		speeds.reserve(capacity);
+		hitboxRadii.reserve(capacity);
+		flags.reserve(capacity);
+		types.reserve(capacity);
+		styles.reserve(capacity);
 	}
-	// Some bullet types with specific variables will use this
-	virtual void resetBullet() {
-		return;
+	void push_back(float x, float y, float xDirection, float yDirection, float speed, float hitboxRadius, char type, short style) {
+		posX.push_back(x);
+		posY.push_back(y);
+		prevX.push_back(x);
+		prevY.push_back(y);
+		dirX.push_back(xDirection);
+		dirY.push_back(yDirection);
+		speeds.push_back(speed);
+		hitboxRadii.push_back(hitboxRadius);
+		flags.push_back(NEUTRAL);
+		types.push_back(type);
+		styles.push_back(style);
+	}
+	// Continue a hash with every array that affects later ticks. Previous positions only affect drawing
+	uint32_t hash(uint32_t hash) const {
+		for (const vector<float>* values : { &posX, &posY, &dirX, &dirY, &speeds, &hitboxRadii })
+			hash = hashVector(hash, *values);
+		hash = hashVector(hash, flags);
+		return hashVector(hash, types);
+	}
+	// Moves the last bullet to the front. Used by spawners, which are kept at the beginning of the arrays
+	void rotateBackToFront() {
+		rotate(posX.begin(), posX.end() - 1, posX.end());
+		rotate(posY.begin(), posY.end() - 1, posY.end());
+		rotate(prevX.begin(), prevX.end() - 1, prevX.end());
+		rotate(prevY.begin(), prevY.end() - 1, prevY.end());
+		rotate(dirX.begin(), dirX.end() - 1, dirX.end());
+		rotate(dirY.begin(), dirY.end() - 1, dirY.end());
+		rotate(speeds.begin(), speeds.end() - 1, speeds.end());
+		rotate(hitboxRadii.begin(), hitboxRadii.end() - 1, hitboxRadii.end());
+		rotate(flags.begin(), flags.end() - 1, flags.end());
+		rotate(types.begin(), types.end() - 1, types.end());
+		rotate(styles.begin(), styles.end() - 1, styles.end());
+	}
+	void erase(int index) {
+		posX.erase(posX.begin() + index);
+		posY.erase(posY.begin() + index);
+		prevX.erase(prevX.begin() + index);
+		prevY.erase(prevY.begin() + index);
+		dirX.erase(dirX.begin() + index);
+		dirY.erase(dirY.begin() + index);
+		speeds.erase(speeds.begin() + index);
+		hitboxRadii.erase(hitboxRadii.begin() + index);
+		flags.erase(flags.begin() + index);
+		types.erase(types.begin() + index);
+		styles.erase(styles.begin() + index);
+	}
+	// Copy a bullet to another index. Used to compact the arrays after culling
+	void moveBullet(int from, int to) {
+		posX[to] = posX[from];
+		posY[to] = posY[from];
+		prevX[to] = prevX[from];
+		prevY[to] = prevY[from];
+		dirX[to] = dirX[from];
+		dirY[to] = dirY[from];
+		speeds[to] = speeds[from];
+		hitboxRadii[to] = hitboxRadii[from];
+		flags[to] = flags[from];
+		types[to] = types[from];
+		styles[to] = styles[from];
+	}
+	// Drop every bullet past the first count bullets
+	void truncate(int count) {
+		posX.resize(count);
+		posY.resize(count);
+		prevX.resize(count);
+		prevY.resize(count);
+		dirX.resize(count);
+		dirY.resize(count);
+		speeds.resize(count);
+		hitboxRadii.resize(count);
+		flags.resize(count);
+		types.resize(count);
+		styles.resize(count);
+	}
+	// Remember where every bullet is before a tick moves it
+	void savePositions() {
+		copy(posX.begin(), posX.end(), prevX.begin());
+		copy(posY.begin(), posY.end(), prevY.begin());
+	}
+	void saveState(StateWriter& writer) const {
+		for (const vector<float>* values : { &posX, &posY, &prevX, &prevY, &dirX, &dirY, &speeds, &hitboxRadii })
+			writer.writeVector(*values);
+		writer.writeVector(flags);
+		writer.writeVector(types);
+		writer.writeVector(styles);
+	}
+	bool loadState(StateReader& reader) {
+		for (vector<float>* values : { &posX, &posY, &prevX, &prevY, &dirX, &dirY, &speeds, &hitboxRadii })
+			reader.readVector(*values);
+		reader.readVector(flags);
+		reader.readVector(types);
+		reader.readVector(styles);
+		for (const vector<float>* values : { &posY, &prevX, &prevY, &dirX, &dirY, &speeds, &hitboxRadii })
+			if (values->size() != posX.size())
+				return false;
+		return !reader.getFailed() && flags.size() == posX.size() && types.size() == posX.size() && styles.size() == posX.size();
+	}
+	// Capacity is kept, so the storage is reused by the next bullets
+	void clear() {
+		posX.clear();
+		posY.clear();
+		prevX.clear();
+		prevY.clear();
+		dirX.clear();
+		dirY.clear();
+		speeds.clear();
+		hitboxRadii.clear();
+		flags.clear();
+		types.clear();
+		styles.clear();
+	}
+};
+
+// Handle to a single bullet inside a BulletData. Cheap to copy; holds no state of its own.
+class Bullet {
+	BulletData* data;
+	int index;
+public:
+	Bullet(BulletData* data, int index) {
+		this->data = data;
+		this->index = index;
 	}
 	// Called to move every frame
-	virtual void processMovement() {
-		sprite->move(xVelocity, yVelocity);
+	void processMovement() {
+		data->posX[index] += data->dirX[index] * data->speeds[index];
+		data->posY[index] += data->dirY[index] * data->speeds[index];
 	}
 #pragma region Rotational transformation
-	// Rotate bullet direction. Optionally provide speed so it does not have to be calculated
-	virtual void rotateBullet(float angleDegrees, float speed = 0) {
+	// Rotate bullet direction by a factor from getRotationFactor. Speed is kept
+	void rotateBullet(sf::Vector2f rotationFactor) {
+		float& xDirection = data->dirX[index];
+		float& yDirection = data->dirY[index];
+		float x = xDirection;
+		xDirection = x * rotationFactor.x - yDirection * rotationFactor.y;
+		yDirection = x * rotationFactor.y + yDirection * rotationFactor.x;
+	}
+	void rotateBullet(float angleDegrees) {
 		if (angleDegrees == 0) return;
-		// Edge cases, if variables are 0
-		if (yVelocity == 0 && xVelocity == 0) {
-			sprite->rotate(angleDegrees);
-			return;
-		}
-		float currentSpeed = (speed != 0) ? speed : sqrt(pow(xVelocity, 2) + pow(yVelocity, 2));
-
-		float currentAngle = sprite->getRotation();
-		xVelocity = cos((currentAngle + angleDegrees) * PI / 180) * currentSpeed;
-		yVelocity = sin((currentAngle + angleDegrees) * PI / 180) * currentSpeed;
-		sprite->rotate(angleDegrees);
+		rotateBullet(getRotationFactor(angleDegrees));
 	}
 	// Given a target radius and speed, rotate a bullet so that it will form a circle of that radius.
-	// Positive speed for clockwise rotation, negative for counterclockwise
-	virtual void rotateArc(float targetRadius, float speed) {
-		// No need to execute if any arguments are 0
-		if (speed == 0 || targetRadius == 0) return;
-		// Speed is passed in so it wouldn't have to be calculated manually
-		rotateBullet(speed * 360 / (2 * PI * targetRadius), abs(speed));
-	}
-	// Sets the rotation and velocity to a specified angle
-	virtual void setRotation(float angleDegrees, float speed = 0) {
-		sprite->setRotation(angleDegrees);
-		float currentSpeed = (speed != 0) ? speed : sqrt(pow(xVelocity, 2) + pow(yVelocity, 2));
-		xVelocity = cos((angleDegrees)*PI / 180) * currentSpeed;
-		yVelocity = sin((angleDegrees)*PI / 180) * currentSpeed;
+	// Positive speed for clockwise rotation, negative for counterclockwise.
+	// Loops over many bullets should compute getArcRotationFactor once and rotate by it instead
+	void rotateArc(float targetRadius, float speed) {
+		rotateBullet(getArcRotationFactor(targetRadius, speed));
+	}
+	// Sets the rotation and velocity to a specified angle. Speed is kept if not given
+	void setRotation(float angleDegrees, float speed = 0) {
+		sf::Vector2f direction = getRotationFactor(angleDegrees);
+		data->dirX[index] = direction.x;
+		data->dirY[index] = direction.y;
+		if (speed != 0)
+			data->speeds[index] = speed;
 	}
 	// Given a rectangular coordinate, aim bullet towards it
-	virtual void aimBullet(sf::Vector2f targetPos) {
-		setRotation(getAngleToPos(sprite->getPosition(), targetPos));
+	void aimBullet(sf::Vector2f targetPos) {
+		setRotation(getAngleToPos(getPosition(), targetPos));
 	}
 	// Flip the x velocity (reflection along the y axis)
-	virtual void flipX() {
-		rotateBullet(180 - sprite->getRotation() * 2);
+	void flipX() {
+		data->dirX[index] = -data->dirX[index];
 	}
 	// Flip the y velocity (reflection along the x axis)
-	virtual void flipY() {
-		rotateBullet(-sprite->getRotation() * 2);
-	}
-	// Sync sprite orientation with actual velocity. Optionally add an offset.
-	void alignAngle(float xOffset = 0, float yOffset = 0) {
-		if (yVelocity + yOffset == 0 && xVelocity + xOffset == 0)
-			return;
-		float angle;
-		angle = atan2f((yVelocity + yOffset), (xVelocity + xOffset)) * 180 / PI;
-		sprite->setRotation(angle);
+	void flipY() {
+		data->dirY[index] = -data->dirY[index];
 	}
 #pragma endregion
 
 
 #pragma region Position and Velocity Transformations
 	// Adds an offset to position instead of setting it
-	virtual void adjustPosition(float x, float y) {
-		sprite->move(x, y);
+	void adjustPosition(float x, float y) {
+		data->posX[index] += x;
+		data->posY[index] += y;
 	}
-	virtual void setPosition(float x, float y) {
-		sprite->setPosition(x, y);
+	void setPosition(float x, float y) {
+		data->posX[index] = x;
+		data->posY[index] = y;
 	}
 	// Adjust position of a bullet rotating in an arc such that its origin point remains the same
-	virtual void alignArc(float deltaRadius, bool clockwise) {
-		// Calculate the angle to the rotation pivot
-		float angleToOrigin = (clockwise) ? (sprite->getRotation() - 90) / 180 * PI : (sprite->getRotation() + 90) / 180 * PI;
-		adjustPosition(deltaRadius * cos(angleToOrigin), deltaRadius * sin(angleToOrigin));
+	void alignArc(float deltaRadius, bool clockwise) {
+		// The pivot is perpendicular to the direction
+		float side = clockwise ? -1 : 1;
+		adjustPosition(-side * deltaRadius * data->dirY[index], side * deltaRadius * data->dirX[index]);
 	}
-	// Sets velocity. Polar version will be used more often
-	virtual void setVelocity(float x, float y) {
-		xVelocity = x;
-		yVelocity = y;
-		alignAngle();
+	// Sets velocity. Polar version will be used more often. The sprite turns to face the new velocity unless it is zero
+	void setVelocity(float x, float y) {
+		float speed = sqrt(x * x + y * y);
+		data->speeds[index] = speed;
+		if (speed == 0)
+			return;
+		data->dirX[index] = x / speed;
+		data->dirY[index] = y / speed;
 	}
 	// Set velocity with polar coordinates
-	virtual void setVelocityR(float speed, float angleDegrees) {
-		xVelocity = speed * cos(angleDegrees * PI / 180);
-		yVelocity = speed * sin(angleDegrees * PI / 180);
-		sprite->setRotation(angleDegrees);
+	void setVelocityR(float speed, float angleDegrees) {
+		setRotation(angleDegrees);
+		data->speeds[index] = speed;
 	}
 	// Adds an offset to velocity
-	virtual void adjustVelocity(float x, float y) {
-		xVelocity += x;
-		yVelocity += y;
-		alignAngle();
+	void adjustVelocity(float x, float y) {
+		sf::Vector2f velocity = getVelocity();
+		setVelocity(velocity.x + x, velocity.y + y);
 	}
 	// Adds a multiplier to the velocity
 	void scaleVelocity(float x, float y) {
-		xVelocity *= x;
-		yVelocity *= y;
-		alignAngle();
+		sf::Vector2f velocity = getVelocity();
+		setVelocity(velocity.x * x, velocity.y * y);
 	}
 	// Set velocity facing current angle
-	virtual void setSpeed(float speed) {
-		xVelocity = speed * cos(sprite->getRotation() * PI / 180);
-		yVelocity = speed * sin(sprite->getRotation() * PI / 180);
+	void setSpeed(float speed) {
+		data->speeds[index] = speed;
 	}
 	// Adds an offset to velocity and maintains rotation
-	virtual void adjustSpeed(float speed) {
-		xVelocity += speed * cos(sprite->getRotation() * PI / 180);
-		yVelocity += speed * sin(sprite->getRotation() * PI / 180);
+	void adjustSpeed(float speed) {
+		data->speeds[index] += speed;
 	}
 #pragma endregion
 
 	// Set flags used for certain patterns
 	void setFlag(char val) {
-		flag = val;
+		data->flags[index] = val;
 	}
 	// Get the angle from source facing target in degrees.
 	float getAngleToPos(sf::Vector2f sourcePos, sf::Vector2f targetPos) {
 		return atan2(targetPos.y - sourcePos.y, targetPos.x - sourcePos.x) * 180 / PI;
 	}
 	char getFlag() {
-		return flag;
+		return data->flags[index];
+	}
+	char getType() {
+		return data->types[index];
 	}
 	sf::Vector2f getPosition() {
-		return sprite->getPosition();
+		return sf::Vector2f(data->posX[index], data->posY[index]);
 	}
 	sf::Vector2f getVelocity() {
-		return sf::Vector2f(xVelocity, yVelocity);
+		return getDirection() * data->speeds[index];
 	}
 	float getSpeed() {
-		return sqrt(pow(xVelocity, 2) + pow(yVelocity, 2));
+		return abs(data->speeds[index]);
 	}
+	sf::Vector2f getDirection() {
+		return sf::Vector2f(data->dirX[index], data->dirY[index]);
+	}
+	// Sprite orientation in degrees. Derived from the direction, so avoid calling it per bullet per frame
 	float getRotation() {
-		return sprite->getRotation();
+		return normalizeAngle(atan2(data->dirY[index], data->dirX[index]) * 180 / PI);
 	}
 
+	// Closed forms of frame-by-frame movement. Each one gives the same result as stepping the frames one at a time
+	// (up to float rounding) in constant time, and does not build up rounding error over long skips.
+
+	// Same as calling processMovement() frameCount times
 	void skipFrames(int frameCount) {
-		for (int i = 0; i < frameCount; i++)
-			processMovement();
+		float distance = data->speeds[index] * frameCount;
+		data->posX[index] += data->dirX[index] * distance;
+		data->posY[index] += data->dirY[index] * distance;
 	}
+	// Same as calling rotateArc(targetRadius, arcSpeed) then processMovement() frameCount times.
+	// Treating the direction d as a complex number and the rotation as r, the position moves by
+	// speed * (r + r^2 + ... + r^n) * d, a geometric series, and the direction ends at r^n * d
+	void skipArcFrames(int frameCount, float targetRadius, float arcSpeed) {
+		if (arcSpeed == 0 || targetRadius == 0) {
+			skipFrames(frameCount);
+			return;
+		}
+		double angle = arcSpeed / targetRadius; // Radians per frame
+		complex<double> direction(data->dirX[index], data->dirY[index]);
+		complex<double> rotation = polar(1.0, angle), finalRotation = polar(1.0, angle * frameCount);
+		complex<double> offset = direction * double(data->speeds[index]) * rotation * (1.0 - finalRotation) / (1.0 - rotation);
+		direction *= finalRotation;
+		data->posX[index] += offset.real();
+		data->posY[index] += offset.imag();
+		data->dirX[index] = direction.real();
+		data->dirY[index] = direction.imag();
+	}
+};
+
+#pragma region Bullet sprites
 
-	// Actual bullet types will override this. 
-	virtual bool checkPlayerCollision(sf::CircleShape& hitbox) = 0;
+// Visual description of a bullet. Bullets sharing a style share one set of sprites.
+struct BulletStyle {
+	char type;
+	sf::Color color;
+	int radius;
 };
-#pragma region Bullet types
 
-// Basic bullet with circular hitbox (sprite does not have to be circular). Can be a bullet type by itself.
-class CircleBullet : virtual public Bullet {
-protected:
-	int hitBoxRadius; // Used for collision detection;
+// Same as translating to a position and rotating to face a unit direction, without converting the direction to an angle
+inline sf::Transform getBulletTransform(float x, float y, float xDirection, float yDirection) {
+	return sf::Transform(xDirection, -yDirection, x,
+		yDirection, xDirection, y,
+		0, 0, 1);
+}
+
+// Append the triangles SFML would draw for a shape: its fill as a fan around the center of its bounds, then its outline as a strip.
+// Positions are transformed by the shape's own transform. Fully transparent parts are skipped since they draw nothing
+inline void appendShapeTriangles(const sf::Shape& shape, vector<sf::Vertex>& triangles) {
+	int count = shape.getPointCount();
+	if (count < 3)
+		return;
+	// The fan is centered on the bounds of the points alone, without the outline
+	vector<sf::Vector2f> points(count);
+	sf::Vector2f low = shape.getPoint(0), high = low;
+	for (int i = 0; i < count; i++) {
+		points[i] = shape.getPoint(i);
+		low = { min(low.x, points[i].x), min(low.y, points[i].y) };
+		high = { max(high.x, points[i].x), max(high.y, points[i].y) };
+	}
+	sf::Vector2f center = (low + high) / 2.f;
+	float outline = shape.getOutlineThickness();
+	const sf::Transform& transform = shape.getTransform();
+
+	sf::Color fillColor = shape.getFillColor();
+	if (fillColor.a != 0)
+		for (int i = 0; i < count; i++) {
+			triangles.push_back(sf::Vertex(transform.transformPoint(center), fillColor));
+			triangles.push_back(sf::Vertex(transform.transformPoint(points[i]), fillColor));
+			triangles.push_back(sf::Vertex(transform.transformPoint(points[(i + 1) % count]), fillColor));
+		}
+
+	sf::Color outlineColor = shape.getOutlineColor();
+	if (outline == 0 || outlineColor.a == 0)
+		return;
+	// Extrude each point along the average of its two edge normals, the same way sf::Shape builds its outline
+	vector<sf::Vector2f> inner(count), outer(count);
+	for (int i = 0; i < count; i++) {
+		sf::Vector2f p0 = points[(i + count - 1) % count], p1 = points[i], p2 = points[(i + 1) % count];
+		sf::Vector2f n1(p0.y - p1.y, p1.x - p0.x), n2(p1.y - p2.y, p2.x - p1.x);
+		float length1 = sqrt(n1.x * n1.x + n1.y * n1.y), length2 = sqrt(n2.x * n2.x + n2.y * n2.y);
+		if (length1 != 0)
+			n1 /= length1;
+		if (length2 != 0)
+			n2 /= length2;
+		sf::Vector2f toCenter = center - p1;
+		if (n1.x * toCenter.x + n1.y * toCenter.y > 0)
+			n1 = -n1;
+		if (n2.x * toCenter.x + n2.y * toCenter.y > 0)
+			n2 = -n2;
+		float factor = 1 + (n1.x * n2.x + n1.y * n2.y);
+		sf::Vector2f normal = (n1 + n2) / factor;
+		inner[i] = transform.transformPoint(p1);
+		outer[i] = transform.transformPoint(p1 + normal * outline);
+	}
+	for (int i = 0; i < count; i++) {
+		int next = (i + 1) % count;
+		triangles.push_back(sf::Vertex(inner[i], outlineColor));
+		triangles.push_back(sf::Vertex(outer[i], outlineColor));
+		triangles.push_back(sf::Vertex(inner[next], outlineColor));
+		triangles.push_back(sf::Vertex(outer[i], outlineColor));
+		triangles.push_back(sf::Vertex(inner[next], outlineColor));
+		triangles.push_back(sf::Vertex(outer[next], outlineColor));
+	}
+}
+
+// Sprites for one bullet style. Built around the origin facing right, then drawn once per bullet with its transform.
+// The shapes are also tessellated once so every bullet of a pattern can be drawn from one vertex array.
+class BulletSprite : public sf::Drawable {
+	vector<sf::Shape*> shapes; // Drawn in order. The first shape is the base sprite.
+	vector<sf::Vertex> triangles; // Every shape as triangles in sprite space, in drawing order
+	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
+		for (sf::Shape* shape : shapes)
+			target.draw(*shape, states);
+	}
 public:
-	CircleBullet(sf::Vector2f position = SCREENPOS, float speed = 0, float angleDegrees = 0, sf::Color color = WHITE, int radius = 0, bool useCircleSprite = true)
-		: Bullet(speed, angleDegrees) {
-		if (useCircleSprite) { // Slight optimization. Use false for child classes that don't use the circle
-			sprite = new SfCircleAtHome(WHITE, radius, position, true, color, max(STANDARDCIRCLEOUTLINE, radius / 3.f));
-			sprite->setRotation(angleDegrees);
+	BulletSprite(BulletStyle style) {
+		sf::Vector2f position(0, 0);
+		sf::Color color = style.color;
+		int radius = style.radius;
+		switch (style.type) {
+		case CIRCLEBULLET:
+			shapes.push_back(new SfCircleAtHome(WHITE, radius, position, true, color, max(STANDARDCIRCLEOUTLINE, radius / 3.f)));
+			break;
+		case RICEBULLET: {
+			SfCircleAtHome* sprite = new SfCircleAtHome(WHITE, radius, position, true, color, SMALLBULLETOUTLINE);
+			sprite->scale(2, 1); // Stretch horizonally to look like an ellipse
+			shapes.push_back(sprite);
+			break;
+		}
+		case DOTBULLET:
+			shapes.push_back(new SfCircleAtHome(WHITE, radius, position, true, color, SMALLBULLETOUTLINE));
+			break;
+		case TALISMANBULLET:
+			shapes.push_back(new SfRectangleAtHome(TRANSPARENTWHITE, { 4.f * radius, 3.f * radius }, position, true, color, STANDARDCIRCLEOUTLINE));
+			break;
+		case BUBBLEBULLET: {
+			// Four concentric circles with colors: transparent, color darkened and partially transparent, original color, white
+			sf::Color darkColor = color;
+			darkColor.a = 200;
+			darkColor.r *= 0.9;
+			darkColor.g *= 0.9;
+			darkColor.b *= 0.9;
+			shapes.push_back(new SfCircleAtHome(TRANSPARENT, radius, position, true, darkColor, radius * 0.6));
+			shapes.push_back(new SfCircleAtHome(TRANSPARENT, radius * 1.3, position, true, color, radius * 0.6));
+			shapes.push_back(new SfCircleAtHome(TRANSPARENT, radius * 1.9, position, true, TRANSPARENTWHITE, radius * 0.75));
+			break;
+		}
+		case ARROWHEADBULLET: {
+			// White rice bullet core
+			SfCircleAtHome* sprite = new SfCircleAtHome(WHITE, radius, position, true, WHITE, SMALLBULLETOUTLINE);
+			sprite->scale(2, 1);
+			shapes.push_back(sprite);
+			// Draw each half of the arrow head
+			for (float i = -1; i <= 1; i += 2)
+			{
+				sf::ConvexShape* arrowPart = new sf::ConvexShape(7);
+				arrowPart->setPoint(0, { radius * 5.f, 0 });
+				arrowPart->setPoint(1, { radius * 4.5f, 0 });
+				arrowPart->setPoint(2, { 0, radius * 1.6f * i });
+				arrowPart->setPoint(3, { -radius * 3.6f, radius * 1.6f * i });
+				arrowPart->setPoint(4, { -radius * 3.6f, radius * 2.5f * i});
+				arrowPart->setPoint(5, { 0, radius * 2.5f * i });
+				arrowPart->setPoint(6, { radius * 5.f, radius * 0.8f * i, });
+				arrowPart->setFillColor(color);
+				shapes.push_back(arrowPart);
+			}
+			break;
 		}
-		hitBoxRadius = max(radius - 3, 3); // Make hitbox slightly smaller than its appearance, but keep a minimum size
+		case SPAWNER:
+			shapes.push_back(new SfCircleAtHome(color, radius, position, true, color, SMALLBULLETOUTLINE));
+			break;
+		default: // Hidden spawners have no sprite
+			break;
+		}
+		for (sf::Shape* shape : shapes)
+			appendShapeTriangles(*shape, triangles);
 	}
-	// Circular hitbox compares distance with sum of radius
-	bool checkPlayerCollision(sf::CircleShape& playerHitbox) {
-		sf::Vector2f hitBoxPos = playerHitbox.getPosition();
-		sf::Vector2f bulletPos = sprite->getPosition();
-		return sqrt(pow(hitBoxPos.x - bulletPos.x, 2) + pow(hitBoxPos.y - bulletPos.y, 2)) <= playerHitbox.getRadius() + hitBoxRadius;
+	const vector<sf::Vertex>& getTriangles() const {
+		return triangles;
+	}
+	// Smallest rect containing every triangle, in sprite space
+	sf::FloatRect getBounds() const {
+		if (triangles.empty())
+			return sf::FloatRect();
+		sf::Vector2f low = triangles[0].position, high = low;
+		for (const sf::Vertex& vertex : triangles) {
+			low = { min(low.x, vertex.position.x), min(low.y, vertex.position.y) };
+			high = { max(high.x, vertex.position.x), max(high.y, vertex.position.y) };
+		}
+		return sf::FloatRect(low, high - low);
+	}
+	// Append the sprite's triangles placed at a position and facing a unit direction
+	void appendTriangles(float x, float y, float xDirection, float yDirection, sf::VertexArray& vertices) const {
+		sf::Transform transform = getBulletTransform(x, y, xDirection, yDirection);
+		for (const sf::Vertex& vertex : triangles)
+			vertices.append(sf::Vertex(transform.transformPoint(vertex.position), vertex.color));
+	}
+	~BulletSprite() {
+		for (sf::Shape* shape : shapes)
+			delete shape;
 	}
 };
 
-// Bullets that require multiple shapes to draw
-class ComplexBullet : virtual public Bullet {
-protected:
-	vector<sf::Shape*> extraSprites;
-	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
-		target.draw(*sprite, states);
-		for (sf::Shape* extraSprite : extraSprites)
-			target.draw(*extraSprite, states);
+// Blend mode for textures holding premultiplied colors
+const sf::BlendMode ATLASBLENDMODE(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha);
+
+// Where one bullet style sits in the atlas
+struct AtlasCell {
+	sf::FloatRect area; // Part of sprite space covered by the cell. Empty for sprites with nothing to draw
+	sf::Vector2f texturePos; // Top left corner of the cell in the atlas texture
+};
+
+// Texture holding every bullet style drawn so far, each rasterized once into its own cell, so a bullet draws as one textured quad.
+// Cells are packed left to right in rows. The texture is only created on first use, and if it cannot be created
+// or runs out of room, findCell returns -1 and callers draw the sprite's triangles instead.
+// Sprites are rasterized onto a transparent texture, which leaves premultiplied colors, so quads must be drawn with ATLASBLENDMODE.
+class BulletAtlas {
+	sf::RenderTexture texture;
+	bool created, failed;
+	vector<BulletStyle> styles;
+	vector<AtlasCell> cells;
+	int rowX, rowY, rowHeight; // Packing cursor and height of the current row
+
+	bool create() {
+		if (!created && !failed) {
+			failed = !texture.create(ATLASSIZE, ATLASSIZE);
+			created = !failed;
+			if (created) {
+				texture.setSmooth(true);
+				texture.clear(TRANSPARENT);
+				texture.display();
+			}
+		}
+		return created;
 	}
 public:
-	ComplexBullet() : Bullet() {}
-	~ComplexBullet() {
-		for (sf::Shape* extraSprite : extraSprites)
-			delete extraSprite;
+	BulletAtlas() {
+		created = false;
+		failed = false;
+		rowX = 0;
+		rowY = 0;
+		rowHeight = 0;
 	}
-	// Called to move every frame
-	virtual void processMovement() {
-		sprite->move(xVelocity, yVelocity);
-		for (sf::Shape* extraSprite : extraSprites){
-			// Sync extra sprites with main sprite
-			extraSprite->setRotation(sprite->getRotation());
-			extraSprite->setPosition(sprite->getPosition());
+	// Returns the cell of a style, rasterizing its sprite the first time it is seen
+	int findCell(const BulletStyle& style, const BulletSprite& sprite) {
+		for (int i = 0; i < styles.size(); i++)
+			if (styles[i].type == style.type && styles[i].color == style.color && styles[i].radius == style.radius)
+				return i;
+		if (!create())
+			return -1;
+		AtlasCell cell;
+		if (!sprite.getTriangles().empty()) {
+			// Snap the cell to whole pixels so the sprite is rasterized at the same offset it is drawn at
+			sf::FloatRect bounds = sprite.getBounds();
+			float left = floor(bounds.left) - ATLASPADDING, top = floor(bounds.top) - ATLASPADDING;
+			int width = ceil(bounds.left + bounds.width) + ATLASPADDING - left;
+			int height = ceil(bounds.top + bounds.height) + ATLASPADDING - top;
+			if (rowX + width > ATLASSIZE) {
+				rowX = 0;
+				rowY += rowHeight;
+				rowHeight = 0;
+			}
+			if (width > ATLASSIZE || rowY + height > ATLASSIZE)
+				return -1; // Atlas is full
+			sf::VertexArray vertices(sf::Triangles);
+			for (const sf::Vertex& vertex : sprite.getTriangles())
+				vertices.append(vertex);
+			sf::RenderStates states;
+			states.transform.translate(rowX - left, rowY - top);
+			texture.draw(vertices, states);
+			texture.display();
+			cell.area = sf::FloatRect(left, top, width, height);
+			cell.texturePos = sf::Vector2f(rowX, rowY);
+			rowX += width;
+			rowHeight = max(rowHeight, height);
 		}
+		styles.push_back(style);
+		cells.push_back(cell);
+		return cells.size() - 1;
+	}
+	// Append two triangles drawing a cell at a position and facing a unit direction
+	void appendQuad(int cellIndex, float x, float y, float xDirection, float yDirection, sf::VertexArray& vertices) const {
+		const AtlasCell& cell = cells[cellIndex];
+		if (cell.area.width == 0)
+			return;
+		sf::Transform transform = getBulletTransform(x, y, xDirection, yDirection);
+		float left = cell.area.left, top = cell.area.top, right = left + cell.area.width, bottom = top + cell.area.height;
+		sf::Vector2f texLeftTop = cell.texturePos, texRightBottom = cell.texturePos + sf::Vector2f(cell.area.width, cell.area.height);
+		sf::Vertex corners[4] = {
+			sf::Vertex(transform.transformPoint(left, top), WHITE, texLeftTop),
+			sf::Vertex(transform.transformPoint(right, top), WHITE, { texRightBottom.x, texLeftTop.y }),
+			sf::Vertex(transform.transformPoint(right, bottom), WHITE, texRightBottom),
+			sf::Vertex(transform.transformPoint(left, bottom), WHITE, { texLeftTop.x, texRightBottom.y })
+		};
+		vertices.append(corners[0]);
+		vertices.append(corners[1]);
+		vertices.append(corners[2]);
+		vertices.append(corners[0]);
+		vertices.append(corners[2]);
+		vertices.append(corners[3]);
+	}
+	const sf::Texture& getTexture() const {
+		return texture.getTexture();
 	}
 };
 
+#pragma endregion
+
 // Laser with instantaneous travel time. Rectangular hitbox;
-class Laser : public ComplexBullet {
+// Lasers carry too much state for the bullet arrays and are stored on their own.
+class Laser : public sf::Drawable {
 protected:
 	// Basic attributes
 	float growthSpeed; // pixel per second. If growth speed = maxWidth, laser grows to max width in one second
 	float maxWidth, currentWidth;
 	sf::Vector2f centerPos;
+	float xVelocity, yVelocity;
 	bool hitboxActive; // Activates collision
 	float activationDelay; // Seconds before collision becomes active
 	float activeDuration; // Duration in seconds before deactivation phase. Permanent if 0;
 
 	// Internal calculation variables
 	int frameCounter;
+	// Hitbox of the beam in its own frame, kept in sync with the rectangle so collision never touches the shape
+	sf::Vector2f direction; // Unit vector along the beam
+	float beamStart, beamEnd; // Extent along the beam from centerPos, including the outline
+	float halfWidth; // Half the beam width, including the outline
 
-	// Operation pointers
-	SfRectangleAtHome* rect; // Pointer shared with sprite for rectangle specific functions
-	SfCircleAtHome* cir; // Same with circle
+	// Sprites
+	SfRectangleAtHome rect;
+	SfCircleAtHome cir;
 	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
-		target.draw(*sprite, states);
-		for (sf::Shape* extraSprite : extraSprites)
-			target.draw(*extraSprite, states);
+		target.draw(rect, states);
+		target.draw(cir, states);
 	}
 public:
 	// Default orientation is straight right, therefore the laser width is actually the rectangle height
-	Laser(sf::Vector2f centerPos = SCREENPOS, float angleDegrees = 0, float maxWidth = 0, float growthSpeed = 1, float activationDelay = 0, float activeDuration = 0, sf::Color color = WHITE)
-		: Bullet(), ComplexBullet() {
+	Laser(sf::Vector2f centerPos = SCREENPOS, float angleDegrees = 0, float maxWidth = 0, float growthSpeed = 1, float activationDelay = 0, float activeDuration = 0, sf::Color color = WHITE) {
 		this->growthSpeed = growthSpeed;
 		this->maxWidth = maxWidth; // SHOULD have a max width of at least 2;
 		this->centerPos = centerPos;
@@ -247,35 +666,46 @@ public:
 		this->activeDuration = activeDuration;
 		frameCounter = 0;
 		hitboxActive = false;
+		xVelocity = 0;
+		yVelocity = 0;
 
 		color.a = 150;
 		currentWidth = 1;
-		rect = new SfRectangleAtHome(WHITE, { WINDOWWIDTH, currentWidth }, centerPos, false, color, 1);
-		sprite = rect;
-		cir = new SfCircleAtHome(WHITE, 2, centerPos, true, color, SMALLBULLETOUTLINE);
+		rect = SfRectangleAtHome(WHITE, { WINDOWWIDTH, currentWidth }, centerPos, false, color, 1);
+		cir = SfCircleAtHome(WHITE, 2, centerPos, true, color, SMALLBULLETOUTLINE);
 		rotateBullet(angleDegrees);
-		extraSprites.push_back(cir);
+		updateHitbox();
 	}
 	void rotateBullet(float angleDegrees) {
-		sprite->rotate(angleDegrees);
+		rect.rotate(angleDegrees);
 		alignSprite();
+		float angle = rect.getRotation() * PI / 180;
+		direction = { cos(angle), sin(angle) };
 	}
 	// Function to set the laser width and align sprites
 	void setWidth(float targetWidth) {
-		rect->setSize({ rect->getSize().x, targetWidth });
-		cir->setRadius(targetWidth / 1.4);
+		rect.setSize({ rect.getSize().x, targetWidth });
+		cir.setRadius(targetWidth / 1.4);
 		alignSprite();
 		// Align circle only during laser size change
-		cir->alignCenter();
-		cir->setPosition(centerPos);
+		cir.alignCenter();
+		cir.setPosition(centerPos);
 		currentWidth = targetWidth;
 		if (targetWidth > 0)
-			rect->setOutlineThickness(max(targetWidth / 5, STARTINGLASEROUTLINE));
+			rect.setOutlineThickness(max(targetWidth / 5, STARTINGLASEROUTLINE));
 		else // No outline if width is zero
-			rect->setOutlineThickness(0);
+			rect.setOutlineThickness(0);
+		updateHitbox();
+	}
+	// Match the beam hitbox to the rectangle's unrotated bounds
+	void updateHitbox() {
+		float outline = rect.getOutlineThickness();
+		beamStart = -outline;
+		beamEnd = rect.getSize().x + outline;
+		halfWidth = rect.getSize().y / 2 + outline;
 	}
 	// Process the active status and growth of laser
-	virtual void processMovement() {
+	void processMovement() {
 		frameCounter++;
 
 		// Deactivate laser
@@ -306,144 +736,363 @@ public:
 		if (xVelocity != 0 || yVelocity != 0) {
 			centerPos.x += xVelocity;
 			centerPos.y += yVelocity;
-			sprite->move(xVelocity, yVelocity);
-			for (sf::Shape* extraSprite : extraSprites)
-				extraSprite->move(xVelocity, yVelocity);
+			rect.move(xVelocity, yVelocity);
+			cir.move(xVelocity, yVelocity);
 		}
 	}
 	// Make sure the rectangle laser is aligned with the circle
 	void alignSprite() {
-		rect->alignY();
-		rect->setPosition(centerPos);
-	}
-	// Adds an offset to position instead of setting it
-	virtual void adjustPosition(float x, float y) {
-		ComplexBullet::adjustPosition(x, y);
+		rect.alignY();
+		rect.setPosition(centerPos);
 	}
 	void resetBullet() {
 		frameCounter = 0;
 		currentWidth = 1;
-		rect->setSize({ rect->getSize().x, currentWidth });
-		rect->setOutlineThickness(SMALLBULLETOUTLINE);
-		cir->setRadius(2);
+		rect.setSize({ rect.getSize().x, currentWidth });
+		rect.setOutlineThickness(SMALLBULLETOUTLINE);
+		updateHitbox();
+		cir.setRadius(2);
 		alignSprite();
 		// Align circle only during laser size change
-		cir->alignCenter();
-		cir->setPosition(centerPos);
+		cir.alignCenter();
+		cir.setPosition(centerPos);
 	}
-	bool checkPlayerCollision(sf::CircleShape& hitbox) {
+	sf::Vector2f getPosition() {
+		return centerPos;
+	}
+	// Save the arguments the laser was made with and how far it has grown and moved
+	void saveState(StateWriter& writer) const {
+		writer.write(centerPos);
+		writer.write(rect.getRotation());
+		writer.write(rect.getOutlineColor());
+		for (float value : { maxWidth, growthSpeed, activationDelay, activeDuration, xVelocity, yVelocity, currentWidth, rect.getOutlineThickness(), cir.getRadius() })
+			writer.write(value);
+		writer.write(frameCounter);
+		writer.write(hitboxActive);
+	}
+	// Rebuild a laser saved by saveState. Sizes the sprites the same way resetBullet does
+	static Laser loadState(StateReader& reader) {
+		sf::Vector2f centerPos;
+		float angle, maxWidth, growthSpeed, activationDelay, activeDuration, xVelocity, yVelocity, currentWidth, outline, circleRadius;
+		sf::Color color;
+		reader.read(centerPos);
+		reader.read(angle);
+		reader.read(color);
+		for (float* value : { &maxWidth, &growthSpeed, &activationDelay, &activeDuration, &xVelocity, &yVelocity, &currentWidth, &outline, &circleRadius })
+			reader.read(*value);
+		Laser laser(centerPos, angle, maxWidth, growthSpeed, activationDelay, activeDuration, color);
+		reader.read(laser.frameCounter);
+		reader.read(laser.hitboxActive);
+		laser.xVelocity = xVelocity;
+		laser.yVelocity = yVelocity;
+		laser.currentWidth = currentWidth;
+		laser.rect.setSize({ laser.rect.getSize().x, currentWidth });
+		laser.rect.setOutlineThickness(outline);
+		laser.updateHitbox();
+		laser.cir.setRadius(circleRadius);
+		laser.alignSprite();
+		laser.cir.alignCenter();
+		laser.cir.setPosition(centerPos);
+		return laser;
+	}
+	bool checkPlayerCollision(sf::CircleShape& hitbox) const {
+		return checkPlayerCollision(hitbox.getPosition(), hitbox.getRadius());
+	}
+	// Project the hitbox center onto the beam's axes and compare against the cached extents.
+	// The circle at the laser's center also collides, up to half the max width
+	bool checkPlayerCollision(sf::Vector2f hitboxPos, float hitboxRadius) const {
 		if (!hitboxActive)
 			return false;
-		// Compare the relative position of the hitbox to an upright rect
-		sf::Vector2f hitboxPos = hitbox.getPosition();
-		SfRectangleAtHome newRec = *rect;
-		newRec.setRotation(0);
-		float angle = rect->getRotation() * PI / 180;
-		sf::Vector2f dist = { hitboxPos.x - centerPos.x, hitboxPos.y - centerPos.y };
-		float mag = sqrt(pow(dist.x, 2) + pow(dist.y, 2));
-		float angle2 = atan2f(dist.y, dist.x);
-		float newX = centerPos.x + (mag)*cos(angle2 - angle);
-		float newY = centerPos.y + (mag)*sin(angle2 - angle);
-		newRec.alignY();
-		newRec.setPosition(centerPos);
-		sf::FloatRect bounds = newRec.getGlobalBounds();
-
-		// Both the hitbox of the rectangle and the circle
-		return bounds.contains(newX, newY) || (sqrt(pow(hitboxPos.x - centerPos.x, 2) + pow(hitboxPos.y - centerPos.y, 2)) <= hitbox.getRadius() + maxWidth / 2);
+		float dx = hitboxPos.x - centerPos.x, dy = hitboxPos.y - centerPos.y;
+		float along = dx * direction.x + dy * direction.y;
+		float across = dy * direction.x - dx * direction.y;
+		if (along >= beamStart && along < beamEnd && across >= -halfWidth && across < halfWidth)
+			return true;
+		float reach = hitboxRadius + maxWidth / 2;
+		return dx * dx + dy * dy <= reach * reach;
+	}
+	// Test one hitbox against many lasers
+	static bool checkPlayerCollision(const vector<Laser>& lasers, sf::Vector2f hitboxPos, float hitboxRadius) {
+		for (const Laser& laser : lasers)
+			if (laser.checkPlayerCollision(hitboxPos, hitboxRadius))
+				return true;
+		return false;
 	}
 };
 
+// Draws bullets from their arrays. Owns the sprite and atlas cell of each style, so only the drawing thread may use it.
+// Bullets are batched into a single draw call in their storage order, so they overlap the same way as drawing them one by one.
+// Uses one atlas quad per bullet when every style is in the atlas, and falls back to the sprites' triangles otherwise
+class BulletRenderer {
+	vector<BulletSprite*> sprites; // Built from styles the first time they are drawn
+	vector<int> atlasCells; // Atlas cell of each style. -1 if the style could not be put in the atlas
+	sf::VertexArray vertices; // Every bullet's triangles, refilled each draw. Keeps its capacity between frames
+	BulletAtlas* atlas; // Shared atlas to draw bullets as textured quads. Bullets are drawn as triangles without one
 
-class RiceBullet : public CircleBullet {
-public:
-	RiceBullet(sf::Vector2f position = SCREENPOS, float speed = 0, float angleDegrees = 0, sf::Color color = WHITE, int radius = 0)
-		: CircleBullet(position, speed, angleDegrees, color, radius), Bullet(speed, angleDegrees) {
-		sprite->setOutlineThickness(SMALLBULLETOUTLINE);
-		sprite->scale(2, 1); // Stretch horizonally to look like an ellipse
+	BulletSprite* getSprite(const vector<BulletStyle>& styles, short style) {
+		while (sprites.size() <= style)
+			sprites.push_back(new BulletSprite(styles[sprites.size()]));
+		return sprites[style];
 	}
-};
-class DotBullet : public CircleBullet {
-public:
-	DotBullet(sf::Vector2f position = SCREENPOS, float speed = 0, float angleDegrees = 0, sf::Color color = WHITE, int radius = 0)
-		: CircleBullet(position, speed, angleDegrees, color, radius), Bullet(speed, angleDegrees) {
-		sprite->setOutlineThickness(SMALLBULLETOUTLINE);
+	// Look up the atlas cell of every style. Returns false if there is no atlas or a style is missing from it
+	bool fillAtlasCells(const vector<BulletStyle>& styles) {
+		if (!atlas)
+			return false;
+		while (atlasCells.size() < styles.size())
+			atlasCells.push_back(atlas->findCell(styles[atlasCells.size()], *getSprite(styles, atlasCells.size())));
+		for (int cell : atlasCells)
+			if (cell < 0)
+				return false;
+		return true;
 	}
-};
-class TalismanBullet : public CircleBullet {
 public:
-	TalismanBullet(sf::Vector2f position = SCREENPOS, float speed = 0, float angleDegrees = 0, sf::Color color = WHITE, int radius = 0)
-		: CircleBullet(position, speed, angleDegrees, color, radius, false), Bullet(speed, angleDegrees) {
-		// Since this does not use the circle sprite, it generates its own sprite.
-		sprite = new SfRectangleAtHome(TRANSPARENTWHITE, { 4.f * radius, 3.f * radius }, position, true, color, STANDARDCIRCLEOUTLINE);
-		sprite->setRotation(angleDegrees);
+	BulletRenderer() {
+		vertices.setPrimitiveType(sf::Triangles);
+		atlas = nullptr;
 	}
-};
-class BubbleBullet : public ComplexBullet, public CircleBullet {
-public:
-	BubbleBullet(sf::Vector2f position = SCREENPOS, float speed = 0, float angleDegrees = 0, sf::Color color = WHITE, int radius = 0)
-		: CircleBullet(position, speed, angleDegrees, color, radius), Bullet(speed, angleDegrees) {
-		// Four concentric circles with colors: transparent, color darkened and partially transparent, original color, white
-		sprite->setFillColor(TRANSPARENT);
-		sprite->setOutlineThickness(radius * 0.6);
-		sf::Color copyColor = color;
-		color.a = 200;
-		color.r *= 0.9;
-		color.g *= 0.9;
-		color.b *= 0.9;
-		sprite->setOutlineColor(color);
-		extraSprites.push_back(new SfCircleAtHome(TRANSPARENT, radius * 1.3, position, true, copyColor, radius * 0.6));
-		extraSprites.push_back(new SfCircleAtHome(TRANSPARENT, radius * 1.9, position, true, TRANSPARENTWHITE, radius * 0.75));
+	~BulletRenderer() {
+		for (BulletSprite* sprite : sprites)
+			delete sprite;
 	}
-};
-// Arrowhead-shaped bullet
-class ArrowheadBullet : public ComplexBullet, public RiceBullet {
-	int hitBoxRadius;
-public:
-	ArrowheadBullet(sf::Vector2f position = SCREENPOS, float speed = 0, float angleDegrees = 0, sf::Color color = WHITE, int radius = 0)
-		: RiceBullet(position, speed, angleDegrees, WHITE, radius), Bullet(speed, angleDegrees) {
-		hitBoxRadius *= 1.2; // Slightly increase hitbox size
-		// Draw each half of the arrow head
-		for (float i = -1; i <= 1; i += 2)
-		{
-			sf::ConvexShape* arrowPart = new sf::ConvexShape(7);
-			arrowPart->setPoint(0, { radius * 5.f, 0 });
-			arrowPart->setPoint(1, { radius * 4.5f, 0 });
-			arrowPart->setPoint(2, { 0, radius * 1.6f * i });
-			arrowPart->setPoint(3, { -radius * 3.6f, radius * 1.6f * i });
-			arrowPart->setPoint(4, { -radius * 3.6f, radius * 2.5f * i});
-			arrowPart->setPoint(5, { 0, radius * 2.5f * i });
-			arrowPart->setPoint(6, { radius * 5.f, radius * 0.8f * i, });
-			arrowPart->setFillColor(color);
-			arrowPart->setPosition(position);
-			arrowPart->setRotation(angleDegrees);
-			extraSprites.push_back(arrowPart);
-		}
+	void setAtlas(BulletAtlas* atlas) {
+		this->atlas = atlas;
 	}
-	virtual void processMovement() {
-		ComplexBullet::processMovement();
+	// Draw bullets part of the way between their previous and current positions. Styles must be the list the bullets index into
+	void draw(sf::RenderTarget& target, sf::RenderStates states, const BulletData& data, const vector<BulletStyle>& styles, const vector<Laser>& lasers, float interpolation) {
+		TRACE_SCOPE("BulletRenderer::draw");
+		ALLOC_SCOPE(ALLOCRENDER);
+		vertices.clear();
+		if (fillAtlasCells(styles)) {
+			for (int i = 0; i < data.size(); i++) {
+				float x = data.prevX[i] + (data.posX[i] - data.prevX[i]) * interpolation;
+				float y = data.prevY[i] + (data.posY[i] - data.prevY[i]) * interpolation;
+				atlas->appendQuad(atlasCells[data.styles[i]], x, y, data.dirX[i], data.dirY[i], vertices);
+			}
+			sf::RenderStates atlasStates = states;
+			atlasStates.texture = &atlas->getTexture();
+			atlasStates.blendMode = ATLASBLENDMODE;
+			if (vertices.getVertexCount() > 0)
+				target.draw(vertices, atlasStates);
+		}
+		else {
+			for (int i = 0; i < data.size(); i++) {
+				float x = data.prevX[i] + (data.posX[i] - data.prevX[i]) * interpolation;
+				float y = data.prevY[i] + (data.posY[i] - data.prevY[i]) * interpolation;
+				getSprite(styles, data.styles[i])->appendTriangles(x, y, data.dirX[i], data.dirY[i], vertices);
+			}
+			if (vertices.getVertexCount() > 0)
+				target.draw(vertices, states);
+		}
+		for (const Laser& laser : lasers)
+			target.draw(laser, states);
 	}
 };
-// Special type of bullet that optionally has a hitbox. Used as a transformable sprite to track bullet spawn positions.
-class Spawner : public CircleBullet {
-	bool visible; // Determines if spawner is visible. Cannot be changed after construction.
+
+// All bullets of a pattern. Simulation runs over the BulletData arrays; sprites are only used when drawing.
+// Acts as the pattern's bullet arena: storage grows in slabs, deleted bullets leave their capacity behind,
+// and sprites are shared per style, so a pattern that has reached its peak bullet count no longer allocates.
+class BulletStore : public sf::Drawable {
+	BulletData data;
+	vector<BulletStyle> styles;
+	vector<Laser> lasers;
+	BulletGrid grid; // Collision broad phase. Rebuilt by binBullets() after bullets move
+	bool gridDirty; // Set when bullets are added or removed after the last binning
+	mutable BulletRenderer renderer;
+	float interpolation; // How far between the last two ticks bullets are drawn. 1 draws the current positions
+
 	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
-		if (visible)
-			target.draw(*sprite, states);
+		renderer.draw(target, states, data, styles, lasers, interpolation);
+	}
+	// Returns the index of a style, adding it if it has not been used by this store before
+	short findStyle(char type, sf::Color color, int radius) {
+		for (int i = 0; i < styles.size(); i++)
+			if (styles[i].type == type && styles[i].color == color && styles[i].radius == radius)
+				return i;
+		styles.push_back({ type, color, radius });
+		return styles.size() - 1;
 	}
 public:
-	Spawner(sf::Vector2f position = SCREENPOS, float speed = 0, float angleDegrees = 0, bool visible = false, sf::Color color = WHITE, int radius = 0)
-		: CircleBullet(position, xVelocity, yVelocity, color, radius), Bullet(speed, angleDegrees) {
-		sprite->setFillColor(color);
-		sprite->setOutlineThickness(SMALLBULLETOUTLINE);
-		sprite->setRotation(angleDegrees);
-		this->visible = visible;
+	BulletStore() {
+		gridDirty = true;
+		interpolation = 1;
 	}
-	bool checkPlayerCollision(sf::CircleShape& playerHitbox) {
-		if (flag != ACTIVESPAWNERHITBOX) // Flag indicates whether hitbox is active
+	Bullet operator[](int index) {
+		return Bullet(&data, index);
+	}
+	// Call at the start of every tick so drawing can interpolate between this tick and the next
+	void savePositions() {
+		data.savePositions();
+	}
+	// Set where between the last two ticks to draw bullets, from 0 (previous tick) to 1 (current tick)
+	void setInterpolation(float interpolation) {
+		this->interpolation = interpolation;
+	}
+	void setAtlas(BulletAtlas* atlas) {
+		renderer.setAtlas(atlas);
+	}
+	int size() {
+		return data.size();
+	}
+	BulletData& getData() {
+		return data;
+	}
+	// Save every bullet, style, and laser. The collision grid and sprites are rebuilt after loading
+	void saveState(StateWriter& writer) const {
+		data.saveState(writer);
+		writer.writeVector(styles);
+		writer.write(uint32_t(lasers.size()));
+		for (const Laser& laser : lasers)
+			laser.saveState(writer);
+	}
+	bool loadState(StateReader& reader) {
+		if (!data.loadState(reader))
 			return false;
-		return CircleBullet::checkPlayerCollision(playerHitbox);
+		reader.readVector(styles);
+		uint32_t laserCount = 0;
+		reader.read(laserCount);
+		lasers.clear();
+		for (uint32_t i = 0; i < laserCount && !reader.getFailed(); i++)
+			lasers.push_back(Laser::loadState(reader));
+		for (short style : data.styles)
+			if (style < 0 || style >= styles.size())
+				return false;
+		data.reserve(max(1, (data.size() + BULLETSLABSIZE - 1) / BULLETSLABSIZE) * BULLETSLABSIZE); // Keep whole slabs for growSlabs
+		gridDirty = true;
+		return !reader.getFailed();
+	}
+	// Hash of the bullet and laser positions and movement. Equal runs give equal hashes on the same build and platform
+	uint32_t getChecksum(uint32_t hash) {
+		hash = data.hash(hash);
+		for (Laser& laser : lasers) {
+			sf::Vector2f position = laser.getPosition();
+			hash = hashBytes(hash, &position, sizeof(position));
+		}
+		return hash;
+	}
+	vector<BulletStyle>& getStyles() {
+		return styles;
+	}
+	vector<Laser>& getLasers() {
+		return lasers;
+	}
+	// Add a bullet of any circular hitbox type using a source position and polar speed vector
+	void addBullet(char type, sf::Vector2f position, float speed, float angleDegrees, sf::Color color, int radius) {
+		if (data.size() == data.capacity())
+			growSlabs();
+		gridDirty = true;
+		float hitboxRadius = max(radius - 3, 3); // Make hitbox slightly smaller than its appearance, but keep a minimum size
+		sf::Vector2f direction = getRotationFactor(angleDegrees);
+		data.push_back(position.x, position.y, direction.x, direction.y, speed, hitboxRadius, type, findStyle(type, color, radius));
+	}
+	// Add count bullets spread evenly around a circle, starting at firstAngleDegrees. The style is looked up once
+	// and each direction is the previous one rotated, so the ring costs no trig per bullet
+	void addRing(char type, sf::Vector2f position, float speed, float firstAngleDegrees, int count, sf::Color color, int radius) {
+		while (data.size() + count > data.capacity())
+			growSlabs();
+		gridDirty = true;
+		float hitboxRadius = max(radius - 3, 3);
+		short style = findStyle(type, color, radius);
+		sf::Vector2f direction = getRotationFactor(firstAngleDegrees), step = getRotationFactor(360.f / count);
+		for (int i = 0; i < count; i++) {
+			data.push_back(position.x, position.y, direction.x, direction.y, speed, hitboxRadius, type, style);
+			direction = { direction.x * step.x - direction.y * step.y, direction.x * step.y + direction.y * step.x };
+		}
+	}
+	// Spawners are always inserted at the beginning of the arrays
+	void addSpawner(sf::Vector2f position, float speed, float angleDegrees, bool visible, sf::Color color, int radius) {
+		addBullet(visible ? SPAWNER : HIDDENSPAWNER, position, speed, angleDegrees, color, radius);
+		data.rotateBackToFront();
+	}
+	void addLaser(Laser laser) {
+		lasers.push_back(laser);
+	}
+	// Double the number of slabs. Every array is grown at once instead of each doubling on its own
+	void growSlabs() {
+		int slabCount = data.capacity() / BULLETSLABSIZE;
+		data.reserve(max(1, slabCount * 2) * BULLETSLABSIZE);
+	}
+	void erase(int index) {
+		data.erase(index);
+		gridDirty = true;
+	}
+	// Delete every bullet outside the bounds in a single pass. Remaining bullets keep their order
+	void deleteOutOfBounds(const sf::FloatRect& bounds) {
+		int count = data.size(), kept = 0;
+		for (int i = 0; i < count; i++)
+			if (bounds.contains(data.posX[i], data.posY[i])) {
+				if (kept != i)
+					data.moveBullet(i, kept);
+				kept++;
+			}
+		data.truncate(kept);
+		gridDirty = true;
+		deleteOutOfBoundsLasers(bounds);
+	}
+	// Lasers are stored apart from bullets and are not counted in any wave
+	void deleteOutOfBoundsLasers(const sf::FloatRect& bounds) {
+		lasers.erase(remove_if(lasers.begin(), lasers.end(), [&bounds](Laser& laser) {
+			return !bounds.contains(laser.getPosition());
+			}), lasers.end());
+	}
+	// Return every bullet and laser to the arena in one step. Capacity, styles and sprites are kept for reuse
+	void reset() {
+		data.clear();
+		lasers.clear();
+		gridDirty = true;
+	}
+	// Move every bullet by its velocity
+	void processMovement() {
+		moveBullets(0, data.size());
+		processLasers();
+	}
+	// Move the bullets in [begin, end) by their velocity. Ranges can be moved on different threads
+	void moveBullets(int begin, int end) {
+		float* posX = data.posX.data();
+		float* posY = data.posY.data();
+		const float* dirX = data.dirX.data();
+		const float* dirY = data.dirY.data();
+		const float* speeds = data.speeds.data();
+		for (int i = begin; i < end; i++) {
+			posX[i] += dirX[i] * speeds[i];
+			posY[i] += dirY[i] * speeds[i];
+		}
+	}
+	void processLasers() {
+		for (Laser& laser : lasers)
+			laser.processMovement();
+	}
+	// Some bullet types with specific variables will use this
+	void resetBullets() {
+		for (Laser& laser : lasers)
+			laser.resetBullet();
+	}
+	void rotateAllBullets(float angleDegrees) {
+		sf::Vector2f rotationFactor = getRotationFactor(angleDegrees);
+		for (int i = 0; i < data.size(); i++)
+			Bullet(&data, i).rotateBullet(rotationFactor);
+		for (Laser& laser : lasers)
+			laser.rotateBullet(angleDegrees);
+	}
+	// Bin bullets into the collision grid. Called once bullets have moved for the frame.
+	// CHECKHITBOXES can only be false if the store holds no spawners
+	template <bool CHECKHITBOXES = true>
+	void binBullets() {
+		grid.build<CHECKHITBOXES>(data.posX.data(), data.posY.data(), data.hitboxRadii.data(), data.types.data(), data.flags.data(), data.size());
+		gridDirty = false;
+	}
+	// Circular hitboxes compare distance with sum of radius. Spawners only collide when flagged.
+	// Only bullets in grid cells near the player are tested
+	bool checkPlayerCollision(sf::CircleShape& playerHitbox) {
+		if (gridDirty)
+			binBullets();
+		sf::Vector2f position = playerHitbox.getPosition();
+		float radius = playerHitbox.getRadius();
+		return grid.checkCollision(position, radius) || Laser::checkPlayerCollision(lasers, position, radius);
+	}
+	// Append the index of every bullet touching the player hitbox. Lasers are not included
+	bool getPlayerCollisions(sf::CircleShape& playerHitbox, vector<int>& hits) {
+		if (gridDirty)
+			binBullets();
+		return grid.collectCollisions(playerHitbox.getPosition(), playerHitbox.getRadius(), hits);
 	}
 };
-
-#pragma endregion
-
@@ -3,6 +3,36 @@
 #include <algorithm>
 using namespace std;
 using namespace Constants;
+// Keys held by the player on one frame. Read from the keyboard by the thread handling the window
+struct PlayerInput {
+	bool left, right, up, down, shoot, focus;
+
+	static PlayerInput readKeyboard() {
+		PlayerInput input;
+		input.left = sf::Keyboard::isKeyPressed(sf::Keyboard::Left);
+		input.right = sf::Keyboard::isKeyPressed(sf::Keyboard::Right);
+		input.up = sf::Keyboard::isKeyPressed(sf::Keyboard::Up);
+		input.down = sf::Keyboard::isKeyPressed(sf::Keyboard::Down);
+		input.shoot = sf::Keyboard::isKeyPressed(sf::Keyboard::Z);
+		input.focus = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift);
+		return input;
+	}
+	// One bit per key in field order, for input logs
+	unsigned char toMask() const {
+		return left | right << 1 | up << 2 | down << 3 | shoot << 4 | focus << 5;
+	}
+	static PlayerInput fromMask(unsigned char mask) {
+		PlayerInput input;
+		input.left = mask & 1;
+		input.right = mask & 2;
+		input.up = mask & 4;
+		input.down = mask & 8;
+		input.shoot = mask & 16;
+		input.focus = mask & 32;
+		return input;
+	}
+};
+
 class Player : public sf::Drawable {
 	SfCircleAtHome hitbox; // Actual hitbox is invisible and slightly smaller.
 	sf::Sprite playerSprite;
@@ -41,24 +71,42 @@ public:
 			hitbox.setPosition(getPosition().x, movementBounds.top + movementBounds.height);
 		playerSprite.setPosition(hitbox.getPosition());
 	}
+	void setPosition(sf::Vector2f position) {
+		hitbox.setPosition(position);
+		playerSprite.setPosition(position);
+	}
+	void saveState(StateWriter& writer) const {
+		writer.write(hitbox.getPosition());
+		writer.write(focused);
+	}
+	bool loadState(StateReader& reader) {
+		sf::Vector2f position;
+		if (!reader.read(position) || !reader.read(focused))
+			return false;
+		setPosition(position);
+		return true;
+	}
 	// Process key controls, such as movement and shooting
 	void onKeyPress(){
+		onKeyPress(PlayerInput::readKeyboard());
+	}
+	void onKeyPress(const PlayerInput& input){
 		sf::Vector2f nextMove(0, 0);
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left))
+		if (input.left)
 			nextMove.x -= moveSpeed;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right))
+		if (input.right)
 			nextMove.x += moveSpeed;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down))
+		if (input.down)
 			nextMove.y += moveSpeed;
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up))
+		if (input.up)
 			nextMove.y -= moveSpeed;
 		if (nextMove.x != 0 && nextMove.y != 0)
 			nextMove *= float(sqrt(2) / 2);
 		
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Z)) {
+		if (input.shoot) {
 			shoot();
 		}
-		if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift)) {
+		if (input.focus) {
 			focused = true;
 			nextMove *= FOCUSSPEEDMODIFIER;
 		}
@@ -85,7 +133,10 @@ public:
 	SfCircleAtHome& getHitbox() {
 		return hitbox;
 	}
-	bool getFocused() {
+	const SfCircleAtHome& getHitbox() const {
+		return hitbox;
+	}
+	bool getFocused() const {
 		return focused;
 	}
 };
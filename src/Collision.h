@@ -0,0 +1,184 @@
+#pragma once
+#include "Constants.h"
+// Pick the widest circle kernel the compiler targets. SSE2 is always available on x64
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define COLLISION_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISION_SSE2
+#endif
+using namespace Constants;
+
+// File to contain collision helpers shared by bullet containers
+
+// Appends the offset of every set bit in a lane mask to hits
+inline void appendMaskHits(int mask, int offset, vector<int>& hits) {
+	for (int lane = 0; mask != 0; lane++, mask >>= 1)
+		if (mask & 1)
+			hits.push_back(offset + lane);
+}
+
+// Test a contiguous block of circles against one circle, using the same distance-squared comparison as the scalar code.
+// If hits is null, returns 1 as soon as any circle overlaps. Otherwise appends the offset of every overlapping circle
+// within the block to hits and returns the number of overlaps.
+inline int collideCircles(const float* posX, const float* posY, const float* radii, int count, float x, float y, float radius, vector<int>* hits = nullptr) {
+	int hitCount = 0;
+	int i = 0;
+#if defined(COLLISION_AVX2)
+	__m256 centerX = _mm256_set1_ps(x), centerY = _mm256_set1_ps(y), centerRadius = _mm256_set1_ps(radius);
+	for (; i + 8 <= count; i += 8) {
+		__m256 dx = _mm256_sub_ps(centerX, _mm256_loadu_ps(posX + i));
+		__m256 dy = _mm256_sub_ps(centerY, _mm256_loadu_ps(posY + i));
+		__m256 reach = _mm256_add_ps(centerRadius, _mm256_loadu_ps(radii + i));
+		__m256 distance = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_mul_ps(reach, reach), _CMP_LE_OQ));
+		if (mask == 0)
+			continue;
+		if (!hits)
+			return 1;
+		int before = hits->size();
+		appendMaskHits(mask, i, *hits);
+		hitCount += hits->size() - before;
+	}
+#elif defined(COLLISION_SSE2)
+	__m128 centerX = _mm_set1_ps(x), centerY = _mm_set1_ps(y), centerRadius = _mm_set1_ps(radius);
+	for (; i + 4 <= count; i += 4) {
+		__m128 dx = _mm_sub_ps(centerX, _mm_loadu_ps(posX + i));
+		__m128 dy = _mm_sub_ps(centerY, _mm_loadu_ps(posY + i));
+		__m128 reach = _mm_add_ps(centerRadius, _mm_loadu_ps(radii + i));
+		__m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(reach, reach)));
+		if (mask == 0)
+			continue;
+		if (!hits)
+			return 1;
+		int before = hits->size();
+		appendMaskHits(mask, i, *hits);
+		hitCount += hits->size() - before;
+	}
+#endif
+	// Scalar fallback and remainder
+	for (; i < count; i++) {
+		float dx = x - posX[i], dy = y - posY[i];
+		float reach = radius + radii[i];
+		if (dx * dx + dy * dy <= reach * reach) {
+			if (!hits)
+				return 1;
+			hits->push_back(i);
+			hitCount++;
+		}
+	}
+	return hitCount;
+}
+
+// Spawners only have a hitbox when flagged. Every other bullet type always collides
+inline bool hasHitbox(char type, char flag) {
+	return (type != SPAWNER && type != HIDDENSPAWNER) || flag == ACTIVESPAWNERHITBOX;
+}
+
+// Uniform grid over the screen used as a broad phase for player collision.
+// Bullets are binned with a counting sort so the bullets of each cell, and of each run of cells in a row,
+// are contiguous in the sorted arrays. Bullets outside the grid are clamped into the border cells.
+class BulletGrid {
+	sf::FloatRect bounds;
+	float cellSize;
+	int columns, rows;
+	vector<int> cellStart; // Index of the first sorted bullet per cell. Has an extra entry marking the end
+	vector<int> bulletCells; // Cell of each bullet by bullet index. -1 for bullets without a hitbox
+	// Bullet attributes sorted by cell
+	vector<int> sortedIndex;
+	vector<float> sortedX, sortedY, sortedRadius;
+	float maxRadius; // Largest hitbox binned. Queries are widened by this so bullets in neighboring cells are not missed
+
+	int getColumn(float x) {
+		int column = (x - bounds.left) / cellSize;
+		return min(max(column, 0), columns - 1);
+	}
+	int getRow(float y) {
+		int row = (y - bounds.top) / cellSize;
+		return min(max(row, 0), rows - 1);
+	}
+public:
+	BulletGrid(sf::FloatRect bounds = SCREENBOUNDS, float cellSize = GRIDCELLSIZE) {
+		this->bounds = bounds;
+		this->cellSize = cellSize;
+		columns = ceil(bounds.width / cellSize);
+		rows = ceil(bounds.height / cellSize);
+		cellStart.resize(columns * rows + 1);
+		maxRadius = 0;
+	}
+	// Bin every bullet that has a hitbox. Callers that know no bullet is a spawner can turn off the hitbox check,
+	// which removes the type and flag loads from the counting loop
+	template <bool CHECKHITBOXES = true>
+	void build(const float* posX, const float* posY, const float* radii, const char* types, const char* flags, int count) {
+		bulletCells.resize(count);
+		fill(cellStart.begin(), cellStart.end(), 0);
+		maxRadius = 0;
+		// Count bullets per cell. Counts are stored one cell ahead so the prefix sum below produces start indices
+		int binned = 0;
+		for (int i = 0; i < count; i++) {
+			if (CHECKHITBOXES && !hasHitbox(types[i], flags[i])) {
+				bulletCells[i] = -1;
+				continue;
+			}
+			int cell = getRow(posY[i]) * columns + getColumn(posX[i]);
+			bulletCells[i] = cell;
+			cellStart[cell + 1]++;
+			maxRadius = max(maxRadius, radii[i]);
+			binned++;
+		}
+		for (int cell = 0; cell < columns * rows; cell++)
+			cellStart[cell + 1] += cellStart[cell];
+
+		sortedIndex.resize(binned);
+		sortedX.resize(binned);
+		sortedY.resize(binned);
+		sortedRadius.resize(binned);
+		// Scatter into cell order. cellStart is advanced while filling and shifted back afterwards
+		for (int i = 0; i < count; i++) {
+			int cell = bulletCells[i];
+			if (cell < 0)
+				continue;
+			int slot = cellStart[cell]++;
+			sortedIndex[slot] = i;
+			sortedX[slot] = posX[i];
+			sortedY[slot] = posY[i];
+			sortedRadius[slot] = radii[i];
+		}
+		for (int cell = columns * rows; cell > 0; cell--)
+			cellStart[cell] = cellStart[cell - 1];
+		cellStart[0] = 0;
+	}
+	// Check the cells around a circular hitbox. Each row of cells in range is one contiguous run of bullets
+	bool checkCollision(sf::Vector2f position, float radius) {
+		return queryCells(position, radius, nullptr);
+	}
+	// Collect the bullet index of every bullet overlapping a circular hitbox. Returns true if there were any
+	bool collectCollisions(sf::Vector2f position, float radius, vector<int>& hits) {
+		return queryCells(position, radius, &hits);
+	}
+	// Runs the circle kernel over each row of cells in range. Stops at the first hit if hits is null
+	bool queryCells(sf::Vector2f position, float radius, vector<int>* hits) {
+		float range = radius + maxRadius;
+		int firstColumn = getColumn(position.x - range), lastColumn = getColumn(position.x + range);
+		int firstRow = getRow(position.y - range), lastRow = getRow(position.y + range);
+		bool collided = false;
+		for (int row = firstRow; row <= lastRow; row++) {
+			int start = cellStart[row * columns + firstColumn];
+			int end = cellStart[row * columns + lastColumn + 1];
+			if (start == end)
+				continue;
+			int before = hits ? hits->size() : 0;
+			if (collideCircles(&sortedX[start], &sortedY[start], &sortedRadius[start], end - start, position.x, position.y, radius, hits) == 0)
+				continue;
+			if (!hits)
+				return true;
+			// Convert offsets within the run to bullet indices
+			for (int k = before; k < hits->size(); k++)
+				(*hits)[k] = sortedIndex[start + (*hits)[k]];
+			collided = true;
+		}
+		return collided;
+	}
+};
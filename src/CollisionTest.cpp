@@ -0,0 +1,108 @@
+// Checks player collision against a brute force distance test
+// Usage: ShootEmUpCollisionTest [seed]
+// Fills patterns with every circular bullet type and spawners with and without ACTIVESPAWNERHITBOX, then compares
+// BulletStore::checkPlayerCollision and PatternManager::getPlayerCollisions with a scalar check of every bullet.
+// Build with SHOOTEMUP_AVX2 to test the AVX2 circle kernel instead of SSE2. Returns 1 on any mismatch
+#include <iostream>
+#include <SFML/Graphics.hpp>
+#include <SFML/Audio.hpp>
+#include <numeric>
+#include <cmath>
+#include "Constants.h"
+#include "Drawings.h"
+#include "Mechanisms.h"
+#include "ThreadPool.h"
+#include "Collision.h"
+#include "Bullet.h"
+#include "Pattern.h"
+using namespace std;
+using namespace Constants;
+
+// Bullet counts per pattern. Small counts cover the kernel's scalar remainder, large ones fill many grid cells
+const vector<int> BULLETCOUNTS = { 0, 1, 7, 8, 9, 17, 100, 1000, 5000 };
+const int HITBOXESPERPATTERN = 300;
+
+// Add bullets of every type at random positions, some outside the screen. Some spawners get a hitbox
+void fillPattern(Pattern* pattern, int count, Random& random) {
+    for (int i = 0; i < count; i++) {
+        sf::Vector2f position(SCREENLEFT - 50 + random.nextInt(SCREENWIDTH + 100), SCREENTOP - 50 + random.nextInt(SCREENHEIGHT + 100));
+        float angle = random.nextInt(360);
+        int radius = 3 + random.nextInt(30);
+        switch (random.nextInt(6)) {
+        case 0:
+            pattern->addCircleBullet(position, 0, angle, DEFAULTCIRCLEBULLETCOLOR, radius);
+            break;
+        case 1:
+            pattern->addRiceBullet(position, 0, angle, DEFAULTRICEBULLETCOLOR, radius);
+            break;
+        case 2:
+            pattern->addDotBullet(position, 0, angle, DEFAULTDOTBULLETCOLOR, radius);
+            break;
+        case 3:
+            pattern->addTalismanBullet(position, 0, angle, DEFAULTTALISMANBULLETCOLOR, radius);
+            break;
+        default: // Spawners go to the front of the arrays
+            pattern->addSpawner(position, 0, angle, random.nextInt(2), DEFAULTSPAWNERCOLOR, radius);
+            if (random.nextInt(2))
+                pattern->getBullets()[0].setFlag(ACTIVESPAWNERHITBOX);
+            break;
+        }
+    }
+}
+// Indices of every bullet overlapping the hitbox, tested one by one
+vector<int> findHitsBruteForce(BulletStore& bullets, sf::Vector2f position, float radius) {
+    const BulletData& data = bullets.getData();
+    vector<int> hits;
+    for (int i = 0; i < data.size(); i++) {
+        if (!hasHitbox(data.types[i], data.flags[i]))
+            continue;
+        float dx = position.x - data.posX[i], dy = position.y - data.posY[i];
+        float reach = radius + data.hitboxRadii[i];
+        if (dx * dx + dy * dy <= reach * reach)
+            hits.push_back(i);
+    }
+    return hits;
+}
+int main(int argc, char* argv[]) {
+    uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    Random random(seed);
+    PatternManager manager(seed);
+    for (int count : BULLETCOUNTS) {
+        Pattern* pattern = new Pattern();
+        fillPattern(pattern, count, random);
+        pattern->setActive(true);
+        manager.addPattern(pattern);
+    }
+
+    int queries = 0, hitQueries = 0, failures = 0;
+    vector<vector<int>> hits;
+    for (int query = 0; query < HITBOXESPERPATTERN; query++) {
+        sf::Vector2f position(SCREENLEFT - 20 + random.nextInt(SCREENWIDTH + 40), SCREENTOP - 20 + random.nextInt(SCREENHEIGHT + 40));
+        float radius = query % 2 ? PLAYERHITBOXRADIUS : 1 + random.nextInt(60);
+        SfCircleAtHome hitbox(WHITE, radius, position, true);
+        manager.getPlayerCollisions(hitbox, hits);
+        for (int i = 0; i < manager.getPatternCount(); i++) {
+            BulletStore& bullets = manager[i]->getBullets();
+            vector<int> expected = findHitsBruteForce(bullets, position, radius);
+            sort(hits[i].begin(), hits[i].end());
+            bool collided = bullets.checkPlayerCollision(hitbox);
+            if (hits[i] != expected || collided != !expected.empty()) {
+                cout << "Mismatch with " << bullets.size() << " bullets, hitbox at (" << position.x << ", " << position.y << ") radius " << radius
+                    << ": expected " << expected.size() << " hits, got " << hits[i].size() << (collided ? ", collided" : ", no collision") << "\n";
+                failures++;
+            }
+            queries++;
+            hitQueries += !expected.empty();
+        }
+    }
+#if defined(COLLISION_AVX2)
+    cout << "kernel: AVX2\n";
+#elif defined(COLLISION_SSE2)
+    cout << "kernel: SSE2\n";
+#else
+    cout << "kernel: scalar\n";
+#endif
+    cout << "queries: " << queries << " (" << hitQueries << " with hits)\n";
+    cout << "mismatches: " << failures << "\n";
+    return failures > 0;
+}
@@ -13,6 +13,8 @@ namespace Constants {
 	const string PLAYERTEXTUREFILEPATH = "assets/reimoo.png";
 	const string ENEMYTEXTUREFILEPATH = "assets/freddy.png";
 	const string FONTFILEPATH = "assets/font.ttf";
+	const string TRACEFILEPATH = "trace.json"; // Written by builds with SHOOTEMUP_TRACE on exit or F4
+	const string ALLOCREPORTFILEPATH = "allocations.txt"; // Written by builds with SHOOTEMUP_ALLOCTRACK on exit
 
 	// Size and dimensions
 	const int WINDOWWIDTH = 1600, WINDOWHEIGHT = 900;
@@ -36,14 +38,49 @@ namespace Constants {
 	const float STARTINGLASEROUTLINE = 1;
 	const float FINALLASEROUTLINE = 2; // Not used currently
 	const float MINHITBOXSIZE = 3;
+	const int BULLETSLABSIZE = 256; // Bullet storage grows by whole slabs of this many bullets
+	const int BULLETCHUNKSIZE = 1024; // Bullets per chunk when a pattern's bullet loops are split across threads
+	const float GRIDCELLSIZE = 32; // Cell size of the collision grid over the screen
+	const int ATLASSIZE = 1024; // Width and height of the bullet sprite atlas texture
+	const int ATLASPADDING = 2; // Empty pixels around each sprite in the atlas so smoothing does not bleed between cells
 
 	// Object positions
 	const sf::Vector2f SCREENPOS(SCREENLEFT, SCREENTOP);
 	const sf::Vector2f FPSTEXTPOS(SCREENLEFT + SCREENWIDTH - 50, SCREENTOP + SCREENHEIGHT - 50);
+	const sf::Vector2f PROFILERTEXTPOS(850, 500);
+	const sf::Vector2f ALLOCTEXTPOS(SCREENLEFT + SCREENWIDTH - 260, SCREENTOP + SCREENHEIGHT - 45);
+	const sf::Vector2f PLAYERSTARTPOS(SCREENLEFT + SCREENWIDTH * 0.5f, SCREENTOP + SCREENHEIGHT * 0.8f); // Roughly where the player spawns
+
+	// Patterns in the order they are added to the pattern manager. Index 0 is the test pattern
+	const vector<string> PATTERNNAMES = { "Test", "BOWAP", "QED", "UFO", "GRT", "MOF", "HGP", "SCOKJ", "SCRIPT" };
 
 	// Mechanical variables
 	const float PLAYERSTANDARDSPEED = 6, FOCUSSPEEDMODIFIER = 0.5f;
-	const float FPS = 60;
+	const float FPS = 60; // Simulation ticks per second. Everything moves per tick
+	const float TICKSECONDS = 1 / FPS;
+	const int COMMANDQUEUESIZE = 256; // Commands the window thread can send before the simulation thread reads them
+	const char SELECTPATTERNCOMMAND = 1, ROTATEBULLETSCOMMAND = 2; // Commands sent to the simulation thread. Held keys are sent separately
+	const string REPLAYMAGIC = "SEUREPLAY"; // Start of every input log file
+	const char REPLAYVERSION = 1; // Bump when the log layout or the simulation changes in a way old logs cannot replay
+	const unsigned char REPLAYCOMMANDSBIT = 0x80; // Set in a tick's input mask when commands were applied before the tick
+	const uint32_t REPLAYCHECKSUMSEED = 2166136261u; // FNV-1a offset basis
+	const string STATEMAGIC = "SEUSTATE"; // Start of every state snapshot file
+	const char STATEVERSION = 2; // Bump when any saved class changes what it saves
+	const string STATEFILEPATH = "state.bin"; // Saved with F5 and loaded with F9
+	// Profiling. Pattern phases are timed per pattern every tick, frame stages once per rendered frame.
+	// The update stage covers every tick run for a frame, so catch-up frames show as one long update
+	const int DELETEPHASE = 0, SPAWNPHASE = 1, MOVEPHASE = 2, BINPHASE = 3, COLLIDEPHASE = 4, PHASECOUNT = 5;
+	const vector<string> PHASELABELS = { "del", "spawn", "move", "bin", "hit" };
+	const int FRAMESTAGE = 0, UPDATESTAGE = 1, DRAWSTAGE = 2, DISPLAYSTAGE = 3, STAGECOUNT = 4;
+	const vector<string> STAGELABELS = { "frame", "update", "draw", "display" };
+	const int TIMINGSAMPLES = 240; // Samples kept per timing ring buffer
+	const float PROFILERREFRESHSECONDS = 0.5; // Statistics are recomputed this often while the overlay is shown
+	const int TRACEBUFFERSPANS = 1 << 19; // Spans kept per thread when tracing. The oldest are overwritten
+	// Allocation tracking tags. UI allocations, such as updating on-screen text, are not counted against a frame
+	const int ALLOCOTHER = 0, ALLOCCULL = 1, ALLOCSPAWN = 2, ALLOCMOVE = 3, ALLOCCOLLIDE = 4, ALLOCRENDER = 5, ALLOCUI = 6, ALLOCTAGCOUNT = 7;
+	const vector<string> ALLOCTAGLABELS = { "other", "cull", "spawn", "move", "collide", "render", "ui" };
+	const int MAXTRACKEDPATTERNS = 16; // Patterns past this many are only counted in the tags
+	const int MAXTICKSPERFRAME = 5; // Ticks run to catch up after a long frame before the simulation is allowed to fall behind
 	const float PI = 3.14159f;
 
 
@@ -84,6 +121,16 @@ namespace Constants {
 
 	// Bullet flags
 	const char NEUTRAL = 0, BOUNCED = 1, REVERSEROTATION = 1, ACTIVESPAWNERHITBOX = 1;
+	// Bullet types. Determines the hitbox and the sprite drawn for a bullet
+	const char CIRCLEBULLET = 0, RICEBULLET = 1, DOTBULLET = 2, TALISMANBULLET = 3, BUBBLEBULLET = 4, ARROWHEADBULLET = 5,
+		SPAWNER = 6, HIDDENSPAWNER = 7;
+	// Pattern script instructions and wave rules. See compileScript in Pattern.h
+	const char SCRIPTSOURCE = 0, SCRIPTRANDOMSOURCE = 1, SCRIPTANGLE = 2, SCRIPTTURN = 3, SCRIPTRANDOMANGLE = 4, SCRIPTSPEED = 5,
+		SCRIPTBULLET = 6, SCRIPTCOLOR = 7, SCRIPTREVERSE = 8, SCRIPTRING = 9, SCRIPTWAIT = 10, SCRIPTLOOP = 11, SCRIPTEND = 12;
+	const char SCRIPTROTATE = 0, SCRIPTACCELERATE = 1, SCRIPTSETSPEED = 2;
+	const int SCRIPTSTEPLIMIT = 10000; // Instructions run per frame at most, so a loop without a wait cannot hang the game
+	const int SCRIPTMAXRINGBULLETS = 2000; // Bullets in one ring at most
+	const int SCRIPTMAXCOUNT = 1000000; // Largest loop count, wait, or rule frame
 
 	// Print stuff for debug
 	template <typename T>
@@ -188,4 +235,26 @@ namespace SCOKJ {
 	const char ISCEILING = 1;
 	const int STREAMVARIANCEXY = 50;
 	const int PHASE1END = 900, PHASE2END = 1800, PHASE3END = 2700; 
+}
+
+// Scripted rings. Ships as a pattern script instead of a subclass
+namespace SCRIPTED {
+	const string RINGSCRIPT = R"(
+# Pairs of cyan rings curling in opposite directions, then speeding up
+bullet rice
+color 0 200 200
+speed 2
+rotate 20 120 0.6
+accelerate 120 180 0.03
+loop 0
+	randomsource 200 80
+	randomangle
+	ring 36
+	reverse
+	turn 5
+	ring 36
+	reverse
+	wait 40
+end
+)";
 }
\ No newline at end of file
@@ -1,6 +1,46 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include <chrono>
 #include "Characters.h"
+
+// What is needed to draw one pattern's bullets, copied from the pattern after a tick
+struct BulletSnapshot {
+	bool active;
+	BulletData data;
+	vector<BulletStyle> styles;
+	vector<Laser> lasers;
+};
+// Copy of everything on the game screen that changes during a tick, so it can be drawn while the next tick runs
+struct FrameSnapshot {
+	vector<BulletSnapshot> patterns;
+	Player player;
+	int hitCount; // Ticks where the player was hit, counted from the start of the game
+	chrono::steady_clock::time_point tickTime; // When the tick finished. Bullets are interpolated from here towards the next tick
+};
+
+// Save every pattern, and the player if given, to a state file. Restoring it continues the run from the same tick
+inline bool saveStateFile(const string& path, PatternManager& manager, const Player* player = nullptr) {
+	StateWriter writer;
+	manager.saveState(writer);
+	writer.write(player != nullptr);
+	if (player)
+		player->saveState(writer);
+	return writer.writeFile(path);
+}
+// Load a state file into a manager with the same patterns as the one that saved it. The player is skipped if not given
+inline bool loadStateFile(const string& path, PatternManager& manager, Player* player = nullptr) {
+	StateReader reader;
+	bool hasPlayer = false;
+	if (!reader.readFile(path) || !manager.loadState(reader) || !reader.read(hasPlayer))
+		return false;
+	if (hasPlayer) {
+		Player skipped;
+		if (!(player ? player : &skipped)->loadState(reader))
+			return false;
+	}
+	return reader.atEnd();
+}
+
 // Class to handle everything on the game screen
 class GameScreen : public sf::Drawable {
 	sf::FloatRect gameBounds;
@@ -9,15 +49,27 @@ class GameScreen : public sf::Drawable {
 	PatternManager* bulletManager;
 	FadeText* hitIndicator; // Delete once I implement death
 	SfRectangleAtHome background, border1, border2;
+	// Drawn instead of the live player and bullets if set, while another thread runs the simulation
+	const FrameSnapshot* snapshot;
+	float snapshotInterpolation;
+	mutable vector<BulletRenderer*> snapshotRenderers; // One per pattern. Only used by the drawing thread
 
 	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
 		target.draw(background, states);
-		target.draw(*player, states);
-		target.draw(*bulletManager, states);
+		if (snapshot) {
+			target.draw(snapshot->player, states);
+			drawSnapshotBullets(target, states);
+			if (snapshot->player.getFocused())
+				target.draw(snapshot->player.getHitbox(), states);
+		}
+		else {
+			target.draw(*player, states);
+			target.draw(*bulletManager, states);
 
-		// Player is drawn in front of bullets, but hitbox is drawn above bullets
-		if (player->getFocused()) 
-			target.draw(player->getHitbox(), states);
+			// Player is drawn in front of bullets, but hitbox is drawn above bullets
+			if (player->getFocused()) 
+				target.draw(player->getHitbox(), states);
+		}
 
 		for (Enemy* enemy : enemies){
 			target.draw(*enemy, states);
@@ -27,6 +79,17 @@ class GameScreen : public sf::Drawable {
 		target.draw(border2, states);
 
 	}
+	void drawSnapshotBullets(sf::RenderTarget& target, sf::RenderStates states) const {
+		while (snapshotRenderers.size() < snapshot->patterns.size()) {
+			snapshotRenderers.push_back(new BulletRenderer());
+			snapshotRenderers.back()->setAtlas(bulletManager->getAtlas());
+		}
+		for (int i = 0; i < snapshot->patterns.size(); i++) {
+			const BulletSnapshot& pattern = snapshot->patterns[i];
+			if (pattern.active)
+				snapshotRenderers[i]->draw(target, states, pattern.data, pattern.styles, pattern.lasers, snapshotInterpolation);
+		}
+	}
 public:
 	GameScreen(PatternManager* bulletManager, FadeText* hit, sf::Texture& playerTexture, sf::Texture& enemyTexture) {
 
@@ -43,18 +106,59 @@ public:
 
 		this->bulletManager = bulletManager;
 		hitIndicator = hit;
+		snapshot = nullptr;
+		snapshotInterpolation = 1;
 	}
 	~GameScreen(){
 		delete player;
 		for (Enemy* enemy : enemies){
 			delete enemy;
 		}
+		for (BulletRenderer* renderer : snapshotRenderers)
+			delete renderer;
 	}
 	// Checks every frame
 	void update() {
-		player->onKeyPress();
-		bulletManager->update();
-		if (bulletManager->checkPlayerCollision(player->getHitbox()))
+		if (simulate(PlayerInput::readKeyboard()))
 			hitIndicator->restart();
 	}
+	// Run one tick with the given keys held. Returns true if the player was hit
+	bool simulate(const PlayerInput& input) {
+		TRACE_SCOPE("GameScreen::simulate");
+		player->onKeyPress(input);
+		bulletManager->update();
+		return bulletManager->checkPlayerCollision(player->getHitbox());
+	}
+	// Hash of the player position and every pattern's bullets after a tick, so replays can find where two runs diverge
+	uint32_t getChecksum() {
+		sf::Vector2f position = player->getPosition();
+		return bulletManager->getChecksum(hashBytes(REPLAYCHECKSUMSEED, &position, sizeof(position)));
+	}
+	// Save or load the patterns and the player. See saveStateFile
+	bool saveState(const string& path) {
+		return saveStateFile(path, *bulletManager, player);
+	}
+	bool loadState(const string& path) {
+		return loadStateFile(path, *bulletManager, player);
+	}
+	// Copy the state drawn by the game screen. Reuses the snapshot's storage from earlier frames
+	void takeSnapshot(FrameSnapshot& snapshot) {
+		snapshot.patterns.resize(bulletManager->getPatternCount());
+		for (int i = 0; i < snapshot.patterns.size(); i++) {
+			Pattern* pattern = (*bulletManager)[i];
+			BulletSnapshot& copy = snapshot.patterns[i];
+			copy.active = pattern->getActive();
+			if (!copy.active)
+				continue;
+			copy.data = pattern->getBullets().getData();
+			copy.styles = pattern->getBullets().getStyles();
+			copy.lasers = pattern->getBullets().getLasers();
+		}
+		snapshot.player = *player;
+	}
+	// Draw from a snapshot instead of the live state. Pass null to go back to the live state
+	void setSnapshot(const FrameSnapshot* snapshot, float interpolation = 1) {
+		this->snapshot = snapshot;
+		snapshotInterpolation = interpolation;
+	}
 };
\ No newline at end of file
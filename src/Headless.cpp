@@ -0,0 +1,184 @@
+// Runs patterns without a window for soak testing and timing
+// Usage: ShootEmUpHeadless <pattern[,pattern...]> <frames> [report interval] [seed] [threads]
+//        ShootEmUpHeadless --replay <input log> [threads]
+// Add --load-state <file> to start from a state file saved with the same patterns, and --save-state <file> to save the end state.
+// A loaded state file replaces the named patterns with the ones active when it was saved, and its seed replaces the seed given.
+// Pattern is a name from the pattern menu or its index. Several patterns separated by commas run together.
+// Replays play an input log recorded by the game as fast as possible and report the first tick whose state differs from the log
+#include <iostream>
+#include <SFML/Graphics.hpp>
+#include <SFML/Audio.hpp>
+#include <numeric>
+#include <cmath>
+#include <chrono>
+#include "Constants.h"
+#include "Drawings.h"
+#include "Mechanisms.h"
+#include "ThreadPool.h"
+#include "Collision.h"
+#include "Bullet.h"
+#include "Pattern.h"
+#include "Characters.h"
+#include "GameScreen.h"
+#include "Replay.h"
+#include "AllocTracker.h"
+using namespace std;
+using namespace Constants;
+// Returns the index of a pattern by name (case insensitive) or by number. -1 if not found
+int findPattern(string name) {
+    for (int i = 0; i < PATTERNNAMES.size(); i++) {
+        string patternName = PATTERNNAMES[i];
+        if (patternName.size() == name.size() && equal(name.begin(), name.end(), patternName.begin(), [](char a, char b) { return tolower(a) == tolower(b); }))
+            return i;
+    }
+    if (!name.empty() && all_of(name.begin(), name.end(), ::isdigit) && stoi(name) < PATTERNNAMES.size())
+        return stoi(name);
+    return -1;
+}
+// Play an input log without drawing. Returns 0 if every tick matched the log, 2 if the state diverged
+int runReplay(const string& path, int threads) {
+    InputReplay replay(path);
+    if (!replay.isValid()) {
+        cout << "Failed to read input log " << path << "\n";
+        return 1;
+    }
+    PatternManager manager(replay.getSeed());
+    manager.setThreadCount(threads);
+    addStandardPatterns(manager);
+    sf::Texture emptyTexture; // Sprites are never drawn
+    GameScreen gameScreen(&manager, nullptr, emptyTexture, emptyTexture);
+
+    int hitTicks = 0;
+    bool hit = false;
+    auto start = chrono::steady_clock::now();
+    while (replay.playTick(gameScreen, manager, hit)) {
+        hitTicks += hit;
+        ALLOC_END_FRAME();
+    }
+    long long totalNs = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    int ticks = replay.getTick();
+    cout << "replay: " << path << "\n";
+    cout << "threads: " << manager.getThreadCount() << "\n";
+    cout << "seed: " << replay.getSeed() << "\n";
+    cout << "ticks: " << ticks << "\n";
+    cout << "ticks with a hit: " << hitTicks << "\n";
+    cout << "total ms: " << totalNs / 1000000.0 << "\n";
+    cout << "ns/tick: " << (ticks > 0 ? totalNs / ticks : 0) << "\n";
+    if (replay.getFirstDivergedTick() >= 0) {
+        cout << "diverged at tick: " << replay.getFirstDivergedTick() << "\n";
+        return 2;
+    }
+    cout << "matched the log\n";
+    return 0;
+}
+int main(int argc, char* argv[]) {
+    // Take out the state file options so the rest keep their positions
+    string loadPath, savePath;
+    vector<char*> arguments;
+    for (int i = 0; i < argc; i++) {
+        if (string(argv[i]) == "--load-state" && i + 1 < argc)
+            loadPath = argv[++i];
+        else if (string(argv[i]) == "--save-state" && i + 1 < argc)
+            savePath = argv[++i];
+        else
+            arguments.push_back(argv[i]);
+    }
+    argc = arguments.size();
+    argv = arguments.data();
+    if (argc >= 3 && string(argv[1]) == "--replay")
+        return runReplay(argv[2], argc > 3 ? atoi(argv[3]) : 1);
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <pattern[,pattern...]> <frames> [report interval] [seed] [threads]\n";
+        cout << "       " << argv[0] << " --replay <input log> [threads]\n";
+        cout << "Patterns:";
+        for (const string& name : PATTERNNAMES)
+            cout << " " << name;
+        cout << "\n";
+        return 1;
+    }
+    vector<int> patternIndices;
+    string patternList = argv[1];
+    for (int start = 0, end; start <= patternList.size(); start = end + 1) {
+        end = patternList.find(',', start);
+        if (end == string::npos)
+            end = patternList.size();
+        string name = patternList.substr(start, end - start);
+        int patternIndex = findPattern(name);
+        if (patternIndex < 0) {
+            cout << "Unknown pattern " << name << "\n";
+            return 1;
+        }
+        patternIndices.push_back(patternIndex);
+    }
+    int frames = atoi(argv[2]);
+    int interval = argc > 3 ? atoi(argv[3]) : FPS; // Frames between bullet count reports. 0 disables them
+    uint64_t seed = argc > 4 ? strtoull(argv[4], nullptr, 10) : time(NULL); // Same seed gives the same run
+    int threads = argc > 5 ? atoi(argv[5]) : 1;
+
+    PatternManager manager(seed);
+    manager.setThreadCount(threads);
+    addStandardPatterns(manager);
+    for (int patternIndex : patternIndices)
+        manager[patternIndex]->setActive(true);
+    if (!loadPath.empty()) {
+        auto loadStart = chrono::steady_clock::now();
+        if (!loadStateFile(loadPath, manager)) {
+            cout << "Failed to load state file " << loadPath << "\n";
+            return 1;
+        }
+        cout << "loaded " << loadPath << " in " << chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count() << " ms\n";
+        // The state file decides which patterns are active, so report on those instead of the ones named
+        patternIndices.clear();
+        for (int i = 0; i < manager.getPatternCount(); i++)
+            if (manager[i]->getActive())
+                patternIndices.push_back(i);
+    }
+    // Hitbox stays where the player spawns
+    SfCircleAtHome hitbox(WHITE, PLAYERHITBOXRADIUS, PLAYERSTARTPOS, true);
+
+    int peakBullets = 0, peakFrame = 0, hitFrames = 0;
+    long long bulletFrames = 0; // Sum of bullet counts over every frame
+    chrono::steady_clock::duration elapsed(0);
+    for (int frame = 1; frame <= frames; frame++) {
+        auto start = chrono::steady_clock::now();
+        manager.update();
+        bool hit = manager.checkPlayerCollision(hitbox);
+        elapsed += chrono::steady_clock::now() - start;
+        ALLOC_END_FRAME();
+
+        int bullets = 0;
+        for (int patternIndex : patternIndices)
+            bullets += manager[patternIndex]->getBullets().size();
+        bulletFrames += bullets;
+        hitFrames += hit;
+        if (bullets > peakBullets) {
+            peakBullets = bullets;
+            peakFrame = frame;
+        }
+        if (interval > 0 && frame % interval == 0)
+            cout << "frame " << frame << ": " << bullets << " bullets\n";
+    }
+    long long totalNs = chrono::duration_cast<chrono::nanoseconds>(elapsed).count();
+    cout << "patterns:";
+    for (int patternIndex : patternIndices)
+        cout << " " << PATTERNNAMES[patternIndex];
+    cout << "\n";
+    cout << "threads: " << manager.getThreadCount() << "\n";
+    cout << "seed: " << manager.getSeed() << "\n"; // From the state file if one was loaded
+    cout << "frames: " << frames << "\n";
+    cout << "peak bullets: " << peakBullets << " at frame " << peakFrame << "\n";
+    cout << "average bullets: " << (frames > 0 ? bulletFrames / frames : 0) << "\n";
+    cout << "frames with a hit: " << hitFrames << "\n";
+    cout << "total ms: " << totalNs / 1000000.0 << "\n";
+    cout << "ns/frame: " << (frames > 0 ? totalNs / frames : 0) << "\n";
+    if (!savePath.empty() && !saveStateFile(savePath, manager))
+        cout << "Failed to save state file " << savePath << "\n";
+    if (TRACE_WRITE(TRACEFILEPATH))
+        cout << "trace: " << TRACEFILEPATH << "\n";
+#ifdef SHOOTEMUP_ALLOCTRACK
+    cout << "frames with allocations: " << AllocTracker::getFramesWithAllocations() << "\n";
+#endif
+    if (ALLOC_WRITE_REPORT(ALLOCREPORTFILEPATH, manager.getPatternCount()))
+        cout << "allocation report: " << ALLOCREPORTFILEPATH << "\n";
+    return 0;
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <vector>
 #include "Constants.h"
 using namespace Constants;
 
@@ -50,6 +55,55 @@ public:
 
 };
 
+// Seedable xoshiro128** generator. Faster than rand() and holds no global state,
+// so each pattern can own one and get the same sequence for the same seed on every run
+class Random {
+	uint32_t state[4];
+
+	static uint32_t rotateLeft(uint32_t x, int k) {
+		return (x << k) | (x >> (32 - k));
+	}
+	// splitmix64 step. Spreads a seed over the whole state
+	static uint64_t splitMix(uint64_t& x) {
+		uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+public:
+	Random(uint64_t seed = 0, uint64_t stream = 0) {
+		setSeed(seed, stream);
+	}
+	// Different streams of the same seed give unrelated sequences
+	void setSeed(uint64_t seed, uint64_t stream = 0) {
+		uint64_t x = splitMix(seed) ^ stream;
+		uint64_t low = splitMix(x), high = splitMix(x);
+		state[0] = low;
+		state[1] = low >> 32;
+		state[2] = high;
+		state[3] = high >> 32;
+	}
+	uint32_t next() {
+		uint32_t result = rotateLeft(state[1] * 5, 7) * 9;
+		uint32_t t = state[1] << 9;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotateLeft(state[3], 11);
+		return result;
+	}
+	// Random integer from 0 to bound - 1. Replaces rand() % bound
+	int nextInt(int bound) {
+		return (uint64_t(next()) * bound) >> 32;
+	}
+	// Random float from 0 to 1, excluding 1
+	float nextFloat() {
+		return (next() >> 8) * (1.0f / 16777216);
+	}
+};
+
 // Class to handle auto repeat / DAS
 class KeyTimer {
 	sf::Clock startTimer, holdTimer;
@@ -227,6 +281,107 @@ public:
 	}
 };
 
+// Appends plain values and arrays of them to a byte buffer for state files. Values are stored as they are in memory,
+// so a state file only loads in a build with the same layout. STATEVERSION guards against layout changes
+class StateWriter {
+	vector<char> buffer;
+public:
+	template <typename T>
+	void write(const T& value) {
+		static_assert(is_trivially_copyable<T>::value, "Only plain values can be written");
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+	template <typename T>
+	void writeVector(const vector<T>& values) {
+		static_assert(is_trivially_copyable<T>::value, "Only plain values can be written");
+		write(uint32_t(values.size()));
+		const char* bytes = reinterpret_cast<const char*>(values.data());
+		buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(T));
+	}
+	size_t size() {
+		return buffer.size();
+	}
+	// Replace a value written earlier, such as a length that was only known afterwards
+	template <typename T>
+	void overwrite(size_t offset, const T& value) {
+		static_assert(is_trivially_copyable<T>::value, "Only plain values can be written");
+		memcpy(buffer.data() + offset, &value, sizeof(T));
+	}
+	// Write the header and buffer in one go. Returns false if the file cannot be written
+	bool writeFile(const string& path) {
+		ofstream file(path, ios::binary);
+		file.write(STATEMAGIC.data(), STATEMAGIC.size());
+		file.write(&STATEVERSION, 1);
+		file.write(buffer.data(), buffer.size());
+		return file.good();
+	}
+};
+
+// Reads values back in the order a StateWriter wrote them. Reads past the end fail instead of reading garbage,
+// and every later read fails too, so callers can check once at the end
+class StateReader {
+	vector<char> buffer;
+	size_t position;
+	bool failed;
+
+	bool take(void* destination, size_t size) {
+		if (failed || buffer.size() - position < size) {
+			failed = true;
+			return false;
+		}
+		memcpy(destination, buffer.data() + position, size);
+		position += size;
+		return true;
+	}
+public:
+	StateReader() {
+		position = 0;
+		failed = true;
+	}
+	// Read the whole file with one read and check its header. Returns false if it is missing or from another version
+	bool readFile(const string& path) {
+		ifstream file(path, ios::binary | ios::ate);
+		failed = true;
+		if (!file)
+			return false;
+		buffer.resize(file.tellg());
+		file.seekg(0);
+		if (!file.read(buffer.data(), buffer.size()) || buffer.size() < STATEMAGIC.size() + 1
+			|| !equal(STATEMAGIC.begin(), STATEMAGIC.end(), buffer.begin()) || buffer[STATEMAGIC.size()] != STATEVERSION)
+			return false;
+		position = STATEMAGIC.size() + 1;
+		failed = false;
+		return true;
+	}
+	template <typename T>
+	bool read(T& value) {
+		static_assert(is_trivially_copyable<T>::value, "Only plain values can be read");
+		return take(&value, sizeof(T));
+	}
+	// Reuses the vector's storage when it is large enough
+	template <typename T>
+	bool readVector(vector<T>& values) {
+		static_assert(is_trivially_copyable<T>::value, "Only plain values can be read");
+		uint32_t size;
+		if (!read(size) || (buffer.size() - position) / sizeof(T) < size) {
+			failed = true;
+			return false;
+		}
+		values.resize(size);
+		return take(values.data(), size * sizeof(T));
+	}
+	bool getFailed() {
+		return failed;
+	}
+	size_t getPosition() {
+		return position;
+	}
+	bool atEnd() {
+		return position == buffer.size();
+	}
+};
+
 // Custom exception for config file reading error
 class ConfigError : public exception {
 public:
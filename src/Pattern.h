@@ -1,12 +1,21 @@
 #pragma once
 #include <numeric>
+#include <sstream>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
 #include "Constants.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "AllocTracker.h"
 // Class to store bullet pattern templates. The base class is for random bullets and children have specific patterns.
 // To design a pattern. Override spawnBullets()
 class Pattern : public sf::Drawable {
 protected:
 	sf::FloatRect screenBounds; // Determines the bounds where the bullets can exist
-	vector<Bullet*> bullets;
+	BulletStore bullets;
+	ThreadPool* threadPool; // Splits large bullet loops across threads if set
+	Random random; // Every random choice of the pattern comes from here. Seeded by the pattern manager
 	// Timing
 	int frameCounter; // Used as a timer and determines where to spawn bullets and when to move them
 	bool active;
@@ -22,13 +31,13 @@ protected:
 
 	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
 		if (active)
-			for (Bullet* bullet : bullets)
-				target.draw(*bullet, states);
+			target.draw(bullets, states);
 	}
 public:
 	Pattern(sf::Vector2f sourcePos = SCREENPOS, int streamCount = 0, float shotFrequency = 0, float baseSpeed = 0) {
 		frameCounter = 0;
 		active = true;
+		threadPool = nullptr;
 		shootOnlyOnce = false;
 		screenBounds = SCREENBOUNDS;
 		expandBounds(0.1); // Expand out-of-bounds so bullets don't get deleted too early.
@@ -39,14 +48,33 @@ public:
 		if (shotFrequency > FPS)
 			shotFrequency = FPS;
 	}
-	~Pattern() {
-		for (Bullet* bullet : bullets)
-			delete bullet;
+	// Run body over the bullets in [begin, end), split into chunks across the thread pool when there are enough bullets.
+	// Each call of body must only change bullets in its own range. Body is a template so only the small wrapper below
+	// is stored in a std::function, which keeps it within the small buffer and off the heap
+	template <typename BODY>
+	void forEachChunk(int begin, int end, const BODY& body) {
+		if (threadPool && end - begin > BULLETCHUNKSIZE)
+			threadPool->parallelFor(end - begin, BULLETCHUNKSIZE, [&](int chunkBegin, int chunkEnd) {
+				body(begin + chunkBegin, begin + chunkEnd);
+			});
+		else if (end > begin)
+			body(begin, end);
 	}
 	// Program bullet movement here. By default, the bullets travel in a straight line.
 	virtual void processMovement() {
-		for (Bullet* bullet : bullets)
-			bullet->processMovement();
+		moveBullets(0, bullets.size());
+		bullets.processLasers();
+	}
+	// Move a range of bullets in a straight line, in chunks
+	void moveBullets(int begin, int end) {
+		forEachChunk(begin, end, [this](int chunkBegin, int chunkEnd) { bullets.moveBullets(chunkBegin, chunkEnd); });
+	}
+	// Bin bullets for collision once they have moved for the frame
+	virtual void binBullets() {
+		bullets.binBullets();
+	}
+	void setThreadPool(ThreadPool* threadPool) {
+		this->threadPool = threadPool;
 	}
 	// Increment frame counter
 	void incrementFrame() {
@@ -58,29 +86,37 @@ public:
 		return;
 	}
 	// Delete all bullets. Typically paired with resetPattern, but not always
+	// Resets the bullet arena in one step; its storage is reused when the pattern starts again
 	virtual void deleteAllBullets() {
-		for (Bullet* bullet : bullets)
-			delete bullet;
-		bullets.clear();
+		bullets.reset();
 	}
 	// Delete out of bound bullets. Some patterns will need to have larger bounds
 	virtual void deleteOutOfBoundsBullets() {
-		for (int i = 0; i < bullets.size(); i++)
-			if (!screenBounds.contains(bullets[i]->getPosition())) {
-				Bullet* temp = bullets[i];
-				bullets.erase(bullets.begin() + i);
-				delete temp;
-				i--; // Reiterate current index since vector has shrunk;
-			}
+		bullets.deleteOutOfBounds(screenBounds);
 	}
 
 	// Reset frame counter
 	virtual void resetPattern() {
 		frameCounter = 0;
-		for (Bullet* bullet : bullets)
-			bullet->resetBullet();
-	}
-	vector<Bullet*>& getBullets() {
+		bullets.resetBullets();
+	}
+	// Save everything that changes while the pattern runs. Patterns with their own counters save them after this
+	virtual void saveState(StateWriter& writer) {
+		writer.write(frameCounter);
+		writer.write(active);
+		writer.write(shootOnlyOnce);
+		writer.write(random);
+		bullets.saveState(writer);
+	}
+	// Load state saved by the same kind of pattern. Returns false if the state does not fit
+	virtual bool loadState(StateReader& reader) {
+		reader.read(frameCounter);
+		reader.read(active);
+		reader.read(shootOnlyOnce);
+		reader.read(random);
+		return bullets.loadState(reader);
+	}
+	BulletStore& getBullets() {
 		return bullets;
 	}
 	bool getActive() {
@@ -119,36 +155,39 @@ public:
 	virtual bool canShoot(float frequency) {
 		return frameCounter % int(FPS / frequency) == 0;
 	}
+	Random& getRandom() {
+		return random;
+	}
 	// Generate a random position deviating from the source position
 	sf::Vector2f generateRandomPosition(int varianceX, int varianceY) {
-		return { sourcePos.x + rand() % varianceX - varianceX / 2, sourcePos.y + rand() % varianceY - varianceY / 2 };
+		return { sourcePos.x + random.nextInt(varianceX) - varianceX / 2, sourcePos.y + random.nextInt(varianceY) - varianceY / 2 };
 	}
 
 	// All addBullet functions use a source position and polar speed vector
 	void addCircleBullet(sf::Vector2f position, float speed = 0, float angleDegrees = 0, sf::Color color = DEFAULTCIRCLEBULLETCOLOR, int radius = STANDARDCIRCLEBULLETRADIUS) {
-		bullets.push_back(new CircleBullet(position, speed, angleDegrees, color, radius));
+		bullets.addBullet(CIRCLEBULLET, position, speed, angleDegrees, color, radius);
 	}
 	void addRiceBullet(sf::Vector2f position, float speed = 0, float angleDegrees = 0, sf::Color color = DEFAULTRICEBULLETCOLOR, int radius = STANDARDRICEBULLETRADIUS) {
-		bullets.push_back(new RiceBullet(position, speed, angleDegrees, color, radius));
+		bullets.addBullet(RICEBULLET, position, speed, angleDegrees, color, radius);
 	}
 	void addDotBullet(sf::Vector2f position, float speed = 0, float angleDegrees = 0, sf::Color color = DEFAULTDOTBULLETCOLOR, int radius = STANDARDDOTBULLETRADIUS) {
-		bullets.push_back(new DotBullet(position, speed, angleDegrees, color, radius));
+		bullets.addBullet(DOTBULLET, position, speed, angleDegrees, color, radius);
 	}
 	void addTalismanBullet(sf::Vector2f position, float speed = 0, float angleDegrees = 0, sf::Color color = DEFAULTTALISMANBULLETCOLOR, int radius = STANDARDTALISMANBULLETRADIUS) {
-		bullets.push_back(new TalismanBullet(position, speed, angleDegrees, color, radius));
+		bullets.addBullet(TALISMANBULLET, position, speed, angleDegrees, color, radius);
 	}
 	void addBubbleBullet(sf::Vector2f position, float speed = 0, float angleDegrees = 0, sf::Color color = DEFAULTBUBBLEBULLETCOLOR, int radius = STANDARDBUBBLEBULLETRADIUS) {
-		bullets.push_back(new BubbleBullet(position, speed, angleDegrees, color, radius));
+		bullets.addBullet(BUBBLEBULLET, position, speed, angleDegrees, color, radius);
 	}
 	void addLaser(sf::Vector2f position, float angleDegrees = 0, float maxWidth = 0, float growthSpeed = 1, float activationDelay = 0, float activeDuration = 0, sf::Color color = DEFAULTLASERCOLOR) {
-		bullets.push_back(new Laser(position, angleDegrees, maxWidth, growthSpeed, activationDelay, activeDuration, color));
+		bullets.addLaser(Laser(position, angleDegrees, maxWidth, growthSpeed, activationDelay, activeDuration, color));
 	}
 	void addArrowheadBullet(sf::Vector2f position, float speed = 0, float angleDegrees = 0, sf::Color color = DEFAULTARROWHEADBULLETCOLOR, int radius = STANDARDARROWHEADBULLETRADIUS) {
-		bullets.push_back(new ArrowheadBullet(position, speed, angleDegrees, color, radius));
+		bullets.addBullet(ARROWHEADBULLET, position, speed, angleDegrees, color, radius);
 	}
 	// Spawners are always inserted at the beginning of the array
 	void addSpawner(sf::Vector2f position, float speed = 0, float angleDegrees = 0, bool visible = false, sf::Color color = DEFAULTSPAWNERCOLOR, int radius = STANDARDSPAWNERRADIUS) {
-		bullets.insert(bullets.begin(), new Spawner(position, speed, angleDegrees, visible, color, radius));
+		bullets.addSpawner(position, speed, angleDegrees, visible, color, radius);
 	}
 };
 
@@ -156,12 +195,35 @@ public:
 class WavePattern : public Pattern {
 protected:
 	// Wave counters organize the bullets and allow manipulation of individual waves
+	// Waves cover the bullet arrays contiguously from index 0, so each wave is a [start, start + count) range
+	vector<int> waveStartIndex; // Stores the index of the first bullet per wave
 	vector<int> waveBulletCount; // Stores the number of remaining bullets per wave
-	vector<int> waveFrameCount; // Stores the time each wave has been active
+	vector<int> waveStartFrame; // Stores the wave clock value when each wave was added
+	int waveClock; // Ticks once per incrementWaveFrames(). A wave's age is the difference from its start frame
 	int currentBulletCount; // Keeps track of the bullet count in each layer for the vectors. Used for patterns with no clearly defined wave sizes
 public:
 	WavePattern(sf::Vector2f sourcePos, float streamCount, float shotFrequency, float baseSpeed) : Pattern(sourcePos, streamCount, shotFrequency, baseSpeed) {
 		currentBulletCount = 0;
+		waveClock = 0;
+	}
+	void saveState(StateWriter& writer) {
+		Pattern::saveState(writer);
+		writer.writeVector(waveStartIndex);
+		writer.writeVector(waveBulletCount);
+		writer.writeVector(waveStartFrame);
+		writer.write(waveClock);
+		writer.write(currentBulletCount);
+	}
+	bool loadState(StateReader& reader) {
+		if (!Pattern::loadState(reader))
+			return false;
+		reader.readVector(waveStartIndex);
+		reader.readVector(waveBulletCount);
+		reader.readVector(waveStartFrame);
+		reader.read(waveClock);
+		reader.read(currentBulletCount);
+		return !reader.getFailed() && waveBulletCount.size() == waveStartIndex.size() && waveStartFrame.size() == waveStartIndex.size()
+			&& getWaveBulletTotal() <= bullets.size();
 	}
 	// Add wave based on current bullets. Optionally use an argument instead of currentBulletCount
 	void addWave(int bulletCount = 0) {
@@ -169,41 +231,59 @@ public:
 			if (currentBulletCount == 0) {
 				return;
 			}
-			waveBulletCount.push_back(currentBulletCount);
+			bulletCount = currentBulletCount;
 			currentBulletCount = 0;
 		}
-		else {
-			waveBulletCount.push_back(bulletCount);
-		}
-		waveFrameCount.push_back(0);
+		waveStartIndex.push_back(getWaveBulletTotal());
+		waveBulletCount.push_back(bulletCount);
+		waveStartFrame.push_back(waveClock);
 		checkValidWaves();
 	}
-	// Check if wave vectors are consistent with actual bullet vectors 
+	// Run body over the bullets of every wave from firstWave on, in chunks like forEachChunk.
+	// A chunk can hold parts of several waves, so body is called once per wave in the chunk with that wave's part of the range
+	template <typename BODY>
+	void forEachWaveChunk(int firstWave, const BODY& body) {
+		if (firstWave >= waveBulletCount.size())
+			return;
+		forEachChunk(waveStartIndex[firstWave], getWaveBulletTotal(), [&](int chunkBegin, int chunkEnd) {
+			// Waves are stored in order. Find the last wave starting at or before the chunk and walk forward
+			int wave = upper_bound(waveStartIndex.begin() + firstWave, waveStartIndex.end(), chunkBegin) - waveStartIndex.begin() - 1;
+			for (; wave < waveStartIndex.size() && waveStartIndex[wave] < chunkEnd; wave++)
+				body(wave, max(chunkBegin, waveStartIndex[wave]), min(chunkEnd, waveStartIndex[wave] + waveBulletCount[wave]));
+		});
+	}
+	// Number of bullets covered by waves
+	int getWaveBulletTotal() {
+		if (waveBulletCount.empty())
+			return 0;
+		return waveStartIndex.back() + waveBulletCount.back();
+	}
+	// Check if wave vectors are consistent with actual bullet vectors. Compiled out of release builds
 	void checkValidWaves() {
-		int counter = 0;
-		for (int& count : waveBulletCount)
-			counter += count;
+#ifndef NDEBUG
+		int counter = getWaveBulletTotal();
 		if (counter != bullets.size()) {
 			print("Wave mismatch");
 			print(bullets.size());
 			print(counter);
 		}
+#endif
 	}
 	// Returns the index of the first bullet in a wave
 	int getStartIndex(int waveindex) {
-		int num = 0; // Number of bullets before current wave
-		for (int i = 0; i < waveindex; i++)
-			num += waveBulletCount[i];
-		return num;
+		return waveStartIndex[waveindex];
 	}
 	// Returns the index of the last bullet in a wave
 	int getEndIndex(int waveindex) {
-		return getStartIndex(waveindex) + waveBulletCount[waveindex] - 1;
+		return waveStartIndex[waveindex] + waveBulletCount[waveindex] - 1;
+	}
+	// Returns the number of wave frames since a wave was added
+	int getWaveFrameCount(int waveindex) {
+		return waveClock - waveStartFrame[waveindex];
 	}
 	// Increment wave frame timers. Needed for time tracking.
 	void incrementWaveFrames() {
-		for (int& counter : waveFrameCount)
-			counter++;
+		waveClock++;
 	}
 	// Must call this after each bullet spawn if using addWave() without arguments,
 	// such as spawning a wave across a period of multiple frames.
@@ -212,44 +292,125 @@ public:
 	}
 	// Assuming all bullets are counted in the wave vectors, updates vectors along with OOB checks
 	virtual void deleteOutOfBoundsBullets() {
-		// Delete out of bound bullets while keeping sync with wave counters
-		for (int i = 0; i < bullets.size(); i++)
-			if (!screenBounds.contains(bullets[i]->getPosition())) {
-				Bullet* temp = bullets[i];
-				bullets.erase(bullets.begin() + i);
-				delete temp;
-
-				// Decrement waveBulletCount at the correct index
-				int cumulativeCount = 0;
-				for (int j = 0; j < waveBulletCount.size(); j++)
-					if (i < waveBulletCount[j] + cumulativeCount) {
-						waveBulletCount[j]--;
-						if (waveBulletCount[j] <= 0) { // Erase empty waves
-							waveBulletCount.erase(waveBulletCount.begin() + j);
-							waveFrameCount.erase(waveFrameCount.begin() + j);
-						}
-						break;
-					}
-					else
-						cumulativeCount += waveBulletCount[j];
-				i--; // Reiterate current index since vector has shrunk;
+		// Delete out of bound bullets while keeping sync with wave counters.
+		// Single pass: surviving bullets are compacted towards the front and each wave's count is decremented as it is walked
+		BulletData& data = bullets.getData();
+		int count = data.size(), kept = 0, i = 0;
+		for (int wave = 0; wave < waveBulletCount.size(); wave++) {
+			waveStartIndex[wave] = kept; // Earlier waves have already been compacted
+			int waveEnd = min(i + waveBulletCount[wave], count);
+			for (; i < waveEnd; i++)
+				if (screenBounds.contains(data.posX[i], data.posY[i])) {
+					if (kept != i)
+						data.moveBullet(i, kept);
+					kept++;
+				}
+				else
+					waveBulletCount[wave]--;
+		}
+		// Bullets that have not been added to a wave yet
+		for (; i < count; i++)
+			if (screenBounds.contains(data.posX[i], data.posY[i])) {
+				if (kept != i)
+					data.moveBullet(i, kept);
+				kept++;
 			}
+		data.truncate(kept);
 
+		// Erase empty waves
+		int keptWaves = 0;
+		for (int wave = 0; wave < waveBulletCount.size(); wave++)
+			if (waveBulletCount[wave] > 0) {
+				waveStartIndex[keptWaves] = waveStartIndex[wave];
+				waveBulletCount[keptWaves] = waveBulletCount[wave];
+				waveStartFrame[keptWaves] = waveStartFrame[wave];
+				keptWaves++;
+			}
+		waveStartIndex.resize(keptWaves);
+		waveBulletCount.resize(keptWaves);
+		waveStartFrame.resize(keptWaves);
+		bullets.deleteOutOfBoundsLasers(screenBounds);
 	}
 	// Delete all bullets and clear vectors
 	virtual void deleteAllBullets() {
 		Pattern::deleteAllBullets();
+		waveStartIndex.clear();
 		waveBulletCount.clear();
-		waveFrameCount.clear();
+		waveStartFrame.clear();
 		currentBulletCount = 0;
 	}
 };
 
+// Pattern that declares the bullet types it emits, as in TypedPattern<Bowap, RICEBULLET>.
+// Per-frame work that depends on the types is picked at compile time: patterns without spawners bin their bullets
+// for collision without checking each bullet's type. Movement calls Derived::moveRange on each chunk directly,
+// so a pattern with its own movement only writes the loop over one range and it is inlined into the chunked update.
+// Adding an undeclared type through the add functions fails to compile. Patterns with types decided at runtime can stay on Pattern
+template <typename Derived, char... TYPES>
+class TypedPattern : public Pattern {
+protected:
+	static constexpr bool HASSPAWNERS = ((TYPES == SPAWNER || TYPES == HIDDENSPAWNER) || ...);
+	static constexpr bool declares(char type) {
+		return ((type == TYPES) || ...);
+	}
+public:
+	// Pattern's adders, hidden so adding an undeclared type fails to compile instead of being binned with the wrong hitbox check
+	template <typename... Args>
+	void addCircleBullet(const Args&... args) {
+		static_assert(declares(CIRCLEBULLET), "Circle bullets are not declared by this pattern");
+		Pattern::addCircleBullet(args...);
+	}
+	template <typename... Args>
+	void addRiceBullet(const Args&... args) {
+		static_assert(declares(RICEBULLET), "Rice bullets are not declared by this pattern");
+		Pattern::addRiceBullet(args...);
+	}
+	template <typename... Args>
+	void addDotBullet(const Args&... args) {
+		static_assert(declares(DOTBULLET), "Dot bullets are not declared by this pattern");
+		Pattern::addDotBullet(args...);
+	}
+	template <typename... Args>
+	void addTalismanBullet(const Args&... args) {
+		static_assert(declares(TALISMANBULLET), "Talisman bullets are not declared by this pattern");
+		Pattern::addTalismanBullet(args...);
+	}
+	template <typename... Args>
+	void addBubbleBullet(const Args&... args) {
+		static_assert(declares(BUBBLEBULLET), "Bubble bullets are not declared by this pattern");
+		Pattern::addBubbleBullet(args...);
+	}
+	template <typename... Args>
+	void addArrowheadBullet(const Args&... args) {
+		static_assert(declares(ARROWHEADBULLET), "Arrowhead bullets are not declared by this pattern");
+		Pattern::addArrowheadBullet(args...);
+	}
+	template <typename... Args>
+	void addSpawner(const Args&... args) {
+		static_assert(HASSPAWNERS, "Spawners are not declared by this pattern");
+		Pattern::addSpawner(args...);
+	}
+	TypedPattern(sf::Vector2f sourcePos, int streamCount, float shotFrequency, float baseSpeed)
+		: Pattern(sourcePos, streamCount, shotFrequency, baseSpeed) {}
+	// Straight line movement. Derived classes hide this to move bullets differently
+	void moveRange(int begin, int end) {
+		bullets.moveBullets(begin, end);
+	}
+	void processMovement() {
+		Derived* pattern = static_cast<Derived*>(this);
+		forEachChunk(0, bullets.size(), [pattern](int begin, int end) { pattern->moveRange(begin, end); });
+		bullets.processLasers();
+	}
+	void binBullets() {
+		bullets.binBullets<HASSPAWNERS>();
+	}
+};
+
 // Direct stream with accelerating angle velocity
-class Bowap : public Pattern {
+class Bowap : public TypedPattern<Bowap, RICEBULLET> {
 public:
 	Bowap(sf::Vector2f sourcePos, int streamCount, float shotFrequency, float baseSpeed)
-		: Pattern(sourcePos, streamCount, shotFrequency, baseSpeed) {}
+		: TypedPattern(sourcePos, streamCount, shotFrequency, baseSpeed) {}
 	void spawnBullets() {
 		if (canShoot()) {
 			// Rotation is constant. Bullet count, frequency, and speed can be set.
@@ -261,34 +422,35 @@ public:
 };
 
 // Ring of bullets, bounces off top left right walls once.
-class QedRipples : public Pattern { // Todo: speed up phases
+class QedRipples : public TypedPattern<QedRipples, RICEBULLET> { // Todo: speed up phases
 	sf::FloatRect bounceBounds;
 public:
 	QedRipples(sf::Vector2f sourcePos, int streamCount, float shotFrequency, float baseSpeed, sf::FloatRect bounceBounds = SCREENBOUNDS)
-		:Pattern(sourcePos, streamCount, shotFrequency, baseSpeed) {
+		:TypedPattern(sourcePos, streamCount, shotFrequency, baseSpeed) {
 		this->bounceBounds = bounceBounds;
 	}
-	void processMovement() {
-		for (Bullet* bullet : bullets) {
-			bullet->processMovement();
+	void moveRange(int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			Bullet bullet = bullets[i];
+			bullet.processMovement();
 			// Check for bounces
-			sf::Vector2f pos = bullet->getPosition();
+			sf::Vector2f pos = bullet.getPosition();
 			if (!bounceBounds.contains(pos)) {
 				// Only bounce once. Do not bounce at the bottom edge
-				if (bullet->getFlag() == BOUNCED || pos.y > bounceBounds.top + bounceBounds.height)
+				if (bullet.getFlag() == BOUNCED || pos.y > bounceBounds.top + bounceBounds.height)
 					continue;
 				if (pos.x < bounceBounds.left || pos.x > bounceBounds.left + bounceBounds.width)
-					bullet->flipX();
+					bullet.flipX();
 				else
-					bullet->flipY();
-				bullet->setFlag(BOUNCED);
+					bullet.flipY();
+				bullet.setFlag(BOUNCED);
 			}
 		}
 	}
 	void spawnBullets() {
 		if (canShoot()) {
 			// Random angle and position
-			int shotAngle = rand() % 360;
+			int shotAngle = random.nextInt(360);
 			sf::Vector2f shotSource;
 			if (frameCounter != 0)
 				shotSource = generateRandomPosition(QED_VARIANCEX, QED_VARIANCEY);
@@ -303,10 +465,9 @@ public:
 class FlyingSaucer : public WavePattern {
 	bool alternate; // Alternate rotation
 	vector<sf::Vector2f> shotSources;
-	vector<float> targetRadii; // Dynamically storing target radii to optimize calculation
+	vector<sf::Vector2f> waveRotations; // Clockwise arc rotation factor of each wave this frame. Filled before the bullets are moved
 	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
-		for (Bullet* bullet : bullets)
-			target.draw(*bullet, states);
+		target.draw(bullets, states);
 	}
 public:
 	FlyingSaucer(sf::Vector2f sourcePos, int streamCount, float shotFrequency, float baseSpeed)
@@ -317,73 +478,61 @@ public:
 		shotSources.push_back({ sourcePos.x + 100, sourcePos.y - 150 });
 		shotSources.push_back({ sourcePos.x - 100, sourcePos.y - 150 });
 		expandBounds(1);
-		// Index 0 should not be used because of how the vector is used,
-		// Initialized as a precaution
-		targetRadii = { 0 }; 
+	}
+	void saveState(StateWriter& writer) {
+		WavePattern::saveState(writer);
+		writer.write(alternate);
+	}
+	bool loadState(StateReader& reader) {
+		return WavePattern::loadState(reader) && reader.read(alternate);
 	}
 	void processMovement() {
 		using namespace UFO;
 		incrementWaveFrames();
+		// Calculate circle radius based on desire behavior. See pattern constants in Constants.h
+		// Bullets of a wave share one rotation, so it is computed once per wave
+		waveRotations.resize(waveBulletCount.size());
+		for (int wave = 0; wave < waveBulletCount.size(); wave++)
+			waveRotations[wave] = getArcRotationFactor(getTargetRadius(getWaveFrameCount(wave)), baseSpeed);
 		// Process movement and ring expansion through rotation speed
-		for (int wave = 0; wave < waveBulletCount.size(); wave++) {
-			// Calculate circle radius based on desire behavior. See pattern constants in Constants.h
-			float targetRadius = 0;
-			int frameCount = waveFrameCount[wave];
-			// Determine speed of ring expansion
-			targetRadius = getTargetRadius(frameCount);
+		forEachWaveChunk(0, [this](int wave, int begin, int end) {
+			sf::Vector2f clockwise = waveRotations[wave];
+			sf::Vector2f counterclockwise(clockwise.x, -clockwise.y);
+			int frameCount = getWaveFrameCount(wave);
 			// Rotate each wave
-			for (int j = getStartIndex(wave); j <= getEndIndex(wave); j++) {
-				Bullet* bullet = bullets[j];
-				bullet->processMovement();
-				if (bullet->getFlag() == NEUTRAL)
-					bullet->rotateArc(targetRadius, baseSpeed);
+			for (int j = begin; j < end; j++) {
+				Bullet bullet = bullets[j];
+				bullet.processMovement();
+				if (bullet.getFlag() == NEUTRAL)
+					bullet.rotateBullet(clockwise);
 				else
-					bullet->rotateArc(targetRadius, -baseSpeed);
+					bullet.rotateBullet(counterclockwise);
 				// Move bullets down
 				if (frameCount < PHASE2CHECKPOINT)
-					bullet->adjustPosition(0, 1);
+					bullet.adjustPosition(0, 1);
 				else // Speed up descent after phase 2
-					bullet->adjustPosition(0, 1.1);
+					bullet.adjustPosition(0, 1.1);
 			}
-		}
+		});
 
 	}
 
-	// Calculate the target radius used in rotation based on the wave frame counter dynamically
+	// Target radius used in rotation as a function of the wave's age. Each phase is a closed form of its own,
+	// so any frame can be evaluated directly
 	float getTargetRadius(int frame) {
 		using namespace UFO;
-		try {
-			// Frame number corresponds to vector index, and the value is the target radius
-			if (targetRadii.size() > frame) 
-				return targetRadii.at(frame);
-			// Vector should be populated contiguously, so size == frame. Double check.
-			if (targetRadii.size() != frame) {
-				cout << "Target Radius may be bugged\n";
-				return 0;
-				}
-
-			// Calculate target radius
-			float targetRadius;
-			if (frame < PHASE1CHECKPOINT) 
-				targetRadius = frame / FPS * STARTVEL + pow(frame / FPS, 2) * PHASE1ACCEL;
-			else if (frame < PHASE2CHECKPOINT) 
-				targetRadius = (frame - PHASE1CHECKPOINT) / FPS * PHASE2VELOCITY + PHASE1ADDEDRADIUS;
-			else 
-				targetRadius = (frame - PHASE2CHECKPOINT) / FPS * PHASE3VELOCITY + PHASE1ADDEDRADIUS + PHASE2ADDEDRADIUS;
-			targetRadii.push_back(targetRadius);
-			return targetRadius;
-
-		}
-		catch (out_of_range e) {
-			cout << "targetRadii out of range\n";
-			return 0;
-		}
+		if (frame < PHASE1CHECKPOINT) 
+			return frame / FPS * STARTVEL + pow(frame / FPS, 2) * PHASE1ACCEL;
+		else if (frame < PHASE2CHECKPOINT) 
+			return (frame - PHASE1CHECKPOINT) / FPS * PHASE2VELOCITY + PHASE1ADDEDRADIUS;
+		else 
+			return (frame - PHASE2CHECKPOINT) / FPS * PHASE3VELOCITY + PHASE1ADDEDRADIUS + PHASE2ADDEDRADIUS;
 	}
 	void spawnBullets() {
 		using namespace UFO;
 		if (canShoot()) {
-			int shotAngle = rand() % 360;
-			int randomColor = rand() % BULLETCOLORS.size();
+			int shotAngle = random.nextInt(360);
+			int randomColor = random.nextInt(BULLETCOLORS.size());
 			int sourceCount = 0;
 			for (sf::Vector2f pos : shotSources) {
 				int index = bullets.size(); // Save index to set flags
@@ -395,10 +544,10 @@ public:
 					alternateCondition = !alternateCondition; // alternateCondition reverses half of the sources' rotation
 				if (alternateCondition) // Index goes from size before adding batch to after adding. Effectively accesses the new batch
 					for (; index < bullets.size(); index++)
-						bullets[index]->setFlag(REVERSEROTATION);
+						bullets[index].setFlag(REVERSEROTATION);
 				sourceCount++;
 				if (sourceCount == shotSources.size() / 2) // Reroll rng
-					shotAngle = rand() % 360;
+					shotAngle = random.nextInt(360);
 			}
 			// Add to the wave counters
 			addWave(shotSources.size() * streamCount);
@@ -408,17 +557,17 @@ public:
 };
 
 // Simple but fast bullet rings 
-class GengetsuTime : public Pattern {
+class GengetsuTime : public TypedPattern<GengetsuTime, DOTBULLET, CIRCLEBULLET> {
 public:
 	GengetsuTime(sf::Vector2f sourcePos, int streamCount, float shotFrequency, float baseSpeed)
-		:Pattern(sourcePos, streamCount, shotFrequency, baseSpeed) {
+		:TypedPattern(sourcePos, streamCount, shotFrequency, baseSpeed) {
 	}
 	void spawnBullets() {
 		if (canShoot()) {
 			// Random angle and position
-			int shotAngle = rand() % 360;
-			bool useDotBullets = rand() % 2;
-			sf::Vector2f shotSource = { sourcePos.x + rand() % 200 - 100, sourcePos.y + rand() % 100 - 50 };
+			int shotAngle = random.nextInt(360);
+			bool useDotBullets = random.nextInt(2);
+			sf::Vector2f shotSource = { sourcePos.x + random.nextInt(200) - 100, sourcePos.y + random.nextInt(100) - 50 };
 			for (int i = 0; i < streamCount; i++) {
 				if (useDotBullets)
 					addDotBullet(shotSource, baseSpeed, shotAngle + i * 360 / streamCount);
@@ -466,8 +615,8 @@ public:
 			// Erase existing spawners and set shot angle
 			if (frameCounter != 0) { // Delete existing spawners
 				for (int i = 0; i < PETALCOUNT; i++)
-					bullets.erase(bullets.begin());
-				shotAngle = rand() % 360;
+					bullets.erase(0);
+				shotAngle = random.nextInt(360);
 			}
 			else {
 				shotAngle = 0; // Preset angle for first shot
@@ -481,13 +630,9 @@ public:
 
 			// Skip frames to set up starting position for spawners
 			for (int i = 0; i < PETALCOUNT; i++) {
-				for (int j = 0; j < FRAMEOFFSET; j++)
-				{
-					bullets[i]->rotateArc(currentCircleRadius, SPAWNERMOVESPEED);
-					bullets[i]->processMovement();
-				}
+				bullets[i].skipArcFrames(ceil(FRAMEOFFSET), currentCircleRadius, SPAWNERMOVESPEED);
 				// Once spawners are in position, adjust spawner speed
-				bullets[i]->setSpeed(adjustedSpawnerSpeed);
+				bullets[i].setSpeed(adjustedSpawnerSpeed);
 			}
 		}
 	}
@@ -495,18 +640,17 @@ public:
 		using namespace MOF;
 		incrementWaveFrames();
 		calculatePhase();
-		// Launch the talisman bullets if they're ready
-		for (int i = 1; i < waveBulletCount.size(); i++)
-		{
-			if (waveFrameCount[i] >= LAUNCHDELAY && waveFrameCount[i] <= LAUNCHDELAY + baseSpeed / LAUNCHACCEL)
+		// Launch the talisman bullets if they're ready. Wave 0 is the spawners
+		forEachWaveChunk(1, [this](int wave, int begin, int end) {
+			int frameCount = getWaveFrameCount(wave);
+			if (frameCount >= LAUNCHDELAY && frameCount <= LAUNCHDELAY + baseSpeed / LAUNCHACCEL)
 			{
-				for (int j = getStartIndex(i); j <= getEndIndex(i); j++)
-					bullets[j]->adjustSpeed(LAUNCHACCEL);
+				for (int j = begin; j < end; j++)
+					bullets[j].adjustSpeed(LAUNCHACCEL);
 			}
-		}
+		});
 		// Update positions for non-spawners
-		for (int i = PETALCOUNT; i < bullets.size(); i++)
-			bullets[i]->processMovement();
+		moveBullets(PETALCOUNT, bullets.size());
 
 		// Process spawner behavior
 		if (phase == 4 || phase == 8) {
@@ -523,8 +667,8 @@ public:
 			for (int i = 0; i < PETALCOUNT; i++) {
 				// Angle towards starting point of layer 2. 
 				float angle = 360 / PETALCOUNT * i + 180 + shotAngle + 90 / PETALCOUNT;
-				bullets[i]->setVelocityR(adjustedSpawnerSpeed, angle + 180 / PETALCOUNT);
-				bullets[i]->setPosition(sourcePos.x + 2 * RADIUS1 * cos(angle / 180 * PI), sourcePos.y + 2 * RADIUS1 * sin(angle / 180 * PI));
+				bullets[i].setVelocityR(adjustedSpawnerSpeed, angle + 180 / PETALCOUNT);
+				bullets[i].setPosition(sourcePos.x + 2 * RADIUS1 * cos(angle / 180 * PI), sourcePos.y + 2 * RADIUS1 * sin(angle / 180 * PI));
 			}
 		}
 		// Start layer 3
@@ -538,15 +682,15 @@ public:
 				// Angle towards starting point of layer 3
 				float dist = 2.365 * RADIUS2; // No easy way of measuring this. Eyeballing from reference
 				float angle = 360 / PETALCOUNT * i + 180 + shotAngle - 90 / PETALCOUNT;
-				bullets[i]->setVelocityR(adjustedSpawnerSpeed, angle + 180 / PETALCOUNT);
-				bullets[i]->setPosition(sourcePos.x + dist * cos(angle / 180 * PI), sourcePos.y + dist * sin(angle / 180 * PI));
+				bullets[i].setVelocityR(adjustedSpawnerSpeed, angle + 180 / PETALCOUNT);
+				bullets[i].setPosition(sourcePos.x + dist * cos(angle / 180 * PI), sourcePos.y + dist * sin(angle / 180 * PI));
 			}
 		}
 		// Stop spawners after each flower
 		else if (frameCounter == spawnPoint + LAYER3CHECKPOINT || frameCounter == spawnPoint + LAYER6CHECKPOINT + refreshFrames) {
 			addWave();
 			for (int i = 0; i < PETALCOUNT; i++)
-				bullets[i]->setVelocity(0, 0);
+				bullets[i].setVelocity(0, 0);
 		}
 
 		// Start flower 2 
@@ -554,12 +698,12 @@ public:
 		else if (frameCounter == spawnPoint + LAYER3CHECKPOINT + refreshFrames) {
 			currentColorIndex = 3;
 			adjustSpawners();
-			shotAngle = rand() % 360; // Reroll shot angle
+			shotAngle = random.nextInt(360); // Reroll shot angle
 
 			// Adjust spawner velocity and position
 			for (int i = 0; i < PETALCOUNT; i++) {
-				bullets[i]->setVelocityR(adjustedSpawnerSpeed, 360 / PETALCOUNT * i + shotAngle);
-				bullets[i]->setPosition(sourcePos.x, sourcePos.y);
+				bullets[i].setVelocityR(adjustedSpawnerSpeed, 360 / PETALCOUNT * i + shotAngle);
+				bullets[i].setPosition(sourcePos.x, sourcePos.y);
 			}
 		}
 		// Start layer 2
@@ -571,8 +715,8 @@ public:
 			for (int i = 0; i < PETALCOUNT; i++) {
 				// Angle towards starting point of layer 2. 
 				float angle = 360 / PETALCOUNT * i + shotAngle - 18;
-				bullets[i]->setVelocityR(adjustedSpawnerSpeed, angle - 180 / PETALCOUNT);
-				bullets[i]->setPosition(sourcePos.x + 2 * RADIUS1 * cos(angle / 180 * PI), sourcePos.y + 2 * RADIUS1 * sin(angle / 180 * PI));
+				bullets[i].setVelocityR(adjustedSpawnerSpeed, angle - 180 / PETALCOUNT);
+				bullets[i].setPosition(sourcePos.x + 2 * RADIUS1 * cos(angle / 180 * PI), sourcePos.y + 2 * RADIUS1 * sin(angle / 180 * PI));
 			}
 		}
 		// Start layer 3
@@ -585,8 +729,8 @@ public:
 				// Angle towards starting point of layer 3
 				float dist = 2.365 * RADIUS2; // No easy way of measuring this. Eyeballing from reference
 				float angle = 360 / PETALCOUNT * i + shotAngle + 90 / PETALCOUNT;
-				bullets[i]->setVelocityR(adjustedSpawnerSpeed, angle - 180 / PETALCOUNT);
-				bullets[i]->setPosition(sourcePos.x + dist * cos(angle / 180 * PI), sourcePos.y + dist * sin(angle / 180 * PI));
+				bullets[i].setVelocityR(adjustedSpawnerSpeed, angle - 180 / PETALCOUNT);
+				bullets[i].setPosition(sourcePos.x + dist * cos(angle / 180 * PI), sourcePos.y + dist * sin(angle / 180 * PI));
 			}
 		}
 		else // Spawn bullets
@@ -598,17 +742,17 @@ public:
 			cycleCounter = (cycleCounter >= scaleDenom - 1) ? 0 : cycleCounter + 1;
 			for (; i < scaleNumer / scaleDenom; i++) {
 				for (int j = 0; j < PETALCOUNT; j++) {
-					Bullet* bullet = bullets[j];
+					Bullet bullet = bullets[j];
 					// 90 aims bullets to petal centers as spawners are tangential. Also add variance to group by quads.
 					if (phase < 4) {
-						addTalismanBullet(bullet->getPosition(), 0, bullet->getRotation() + 90 + 15 + BULLETANGLEVARIANCE[varianceCounter] / bulletDensity, BULLETCOLORS[currentColorIndex]);
-						bullet->rotateArc(currentCircleRadius, adjustedSpawnerSpeed);
+						addTalismanBullet(bullet.getPosition(), 0, bullet.getRotation() + 90 + 15 + BULLETANGLEVARIANCE[varianceCounter] / bulletDensity, BULLETCOLORS[currentColorIndex]);
+						bullet.rotateArc(currentCircleRadius, adjustedSpawnerSpeed);
 					}
 					else {
-						addTalismanBullet(bullet->getPosition(), 0, bullet->getRotation() - 90 - 10 - BULLETANGLEVARIANCE[varianceCounter] / bulletDensity, BULLETCOLORS[currentColorIndex]);
-						bullet->rotateArc(currentCircleRadius, -adjustedSpawnerSpeed);
+						addTalismanBullet(bullet.getPosition(), 0, bullet.getRotation() - 90 - 10 - BULLETANGLEVARIANCE[varianceCounter] / bulletDensity, BULLETCOLORS[currentColorIndex]);
+						bullet.rotateArc(currentCircleRadius, -adjustedSpawnerSpeed);
 					}
-					bullet->processMovement();
+					bullet.processMovement();
 					incrementCurrentBulletCount();
 				}
 				varianceCounter = varianceCounter >= BULLETANGLEVARIANCE.size() - 1 ? 0 : varianceCounter + 1;
@@ -621,6 +765,22 @@ public:
 		varianceCounter = 0;
 		cycleCounter = 0;
 	}
+	void saveState(StateWriter& writer) {
+		WavePattern::saveState(writer);
+		for (int value : { varianceCounter, spawnPoint, cycleCounter, shotAngle, scaleNumer, scaleDenom, currentColorIndex, phase })
+			writer.write(value);
+		for (float value : { adjustedSpawnerSpeed, currentCircleRadius, bulletDensity })
+			writer.write(value);
+	}
+	bool loadState(StateReader& reader) {
+		if (!WavePattern::loadState(reader))
+			return false;
+		for (int* value : { &varianceCounter, &spawnPoint, &cycleCounter, &shotAngle, &scaleNumer, &scaleDenom, &currentColorIndex, &phase })
+			reader.read(*value);
+		for (float* value : { &adjustedSpawnerSpeed, &currentCircleRadius, &bulletDensity })
+			reader.read(*value);
+		return !reader.getFailed();
+	}
 	// Calculate current pattern phase
 	void calculatePhase() {
 		using namespace MOF;
@@ -688,7 +848,7 @@ public:
 		:WavePattern(sourcePos, streamCount, shotFrequency, baseSpeed) {
 		alternate = true;
 		shotCounter = 0;
-		shotSource = { sourcePos.x + rand() % 200 - 100, sourcePos.y + rand() % 100 - 50 };
+		shotSource = sourcePos; // Rolled by resetPattern, once the pattern manager has seeded the generator
 		waveEnd = -HGP::WAVEDELAY;
 		expandBounds(0.2);
 	}
@@ -698,7 +858,7 @@ public:
 			return;
 		if (canShoot()) {
 			// Random angle and position
-			int shotAngle = rand() % 360;
+			int shotAngle = random.nextInt(360);
 			for (int i = 0; i < streamCount; i++) {
 				if (alternate) {
 					addCircleBullet(shotSource, baseSpeed, shotAngle + i * 360.f / streamCount, ORANGE, BULLETSIZE);
@@ -713,11 +873,11 @@ public:
 			// Set the flags for rotation movement
 			if (alternate)
 				for (int i = bullets.size() - streamCount * 2; i < bullets.size(); i++)
-					bullets[i]->setFlag(REVERSEROTATION);
+					bullets[i].setFlag(REVERSEROTATION);
 			alternate = !alternate;
 			if (++shotCounter >= WAVECOUNT) { // Reroll shot source
 				shotCounter = 0;
-				shotSource = { sourcePos.x + rand() % 200 - 100, sourcePos.y + rand() % 100 - 50 };
+				shotSource = { sourcePos.x + random.nextInt(200) - 100, sourcePos.y + random.nextInt(100) - 50 };
 				waveEnd = frameCounter;
 			}
 
@@ -726,30 +886,47 @@ public:
 	void processMovement() {
 		using namespace HGP;
 		incrementWaveFrames();
+		sf::Vector2f forward = getRotationFactor(ROTATIONANGLE), reverse(forward.x, -forward.y);
 		// Process movement and ring expansion through rotation speed
-		for (int wave = 0; wave < waveBulletCount.size(); wave++) {
-			int frameCount = waveFrameCount[wave];
+		forEachWaveChunk(0, [&](int wave, int begin, int end) {
+			int frameCount = getWaveFrameCount(wave);
 			// Rotate each wave
-			for (int j = getStartIndex(wave); j <= getEndIndex(wave); j++) {
-				Bullet* bullet = bullets[j];
-				bullet->processMovement();
+			for (int j = begin; j < end; j++) {
+				Bullet bullet = bullets[j];
+				bullet.processMovement();
 				// Rotates the bullet only for a specific period in time
 				if (frameCount > ROTATIONSTART && frameCount <= ROTATIONEND)
 				{
-					if (bullet->getFlag() == REVERSEROTATION)
-						bullet->rotateBullet(ROTATIONANGLE);
+					if (bullet.getFlag() == REVERSEROTATION)
+						bullet.rotateBullet(forward);
 					else
-						bullet->rotateBullet(-ROTATIONANGLE);
+						bullet.rotateBullet(reverse);
 				}
 			}
-		}
+		});
 	}
 	void resetPattern() {
 		Pattern::resetPattern();
 		waveEnd = -HGP::WAVEDELAY;
 		shotCounter = 0;
 		alternate = true;
-		shotSource = { sourcePos.x + rand() % 200 - 100, sourcePos.y + rand() % 100 - 50 };
+		shotSource = { sourcePos.x + random.nextInt(200) - 100, sourcePos.y + random.nextInt(100) - 50 };
+	}
+	void saveState(StateWriter& writer) {
+		WavePattern::saveState(writer);
+		writer.write(alternate);
+		writer.write(shotSource);
+		writer.write(shotCounter);
+		writer.write(waveEnd);
+	}
+	bool loadState(StateReader& reader) {
+		if (!WavePattern::loadState(reader))
+			return false;
+		reader.read(alternate);
+		reader.read(shotSource);
+		reader.read(shotCounter);
+		reader.read(waveEnd);
+		return !reader.getFailed();
 	}
 };
 
@@ -764,6 +941,13 @@ public:
 		expandBounds(0.1);
 		ceilingAlternate = true;
 	}
+	void saveState(StateWriter& writer) {
+		WavePattern::saveState(writer);
+		writer.write(ceilingAlternate);
+	}
+	bool loadState(StateReader& reader) {
+		return WavePattern::loadState(reader) && reader.read(ceilingAlternate);
+	}
 
 	void spawnBullets() {
 		using namespace SCOKJ;
@@ -778,7 +962,7 @@ public:
 			addWave(CEILINGCOUNT);
 			// Set flag to be dropped
 			for (int i = bullets.size() - CEILINGCOUNT; i < bullets.size(); i++)
-				bullets[i]->setFlag(ISCEILING);
+				bullets[i].setFlag(ISCEILING);
 			ceilingAlternate = !ceilingAlternate;
 		}
 		// Spiral stream
@@ -811,31 +995,31 @@ public:
 	}
 	void processMovement() {
 		using namespace SCOKJ;
-		for (Bullet* bullet : bullets)
-			bullet->processMovement();
+		moveBullets(0, bullets.size());
+		bullets.processLasers();
 		incrementWaveFrames();
 		for (int wave = 0; wave < waveBulletCount.size(); wave++) {
 			// Check that the wave is a ceiling wave
 			int startIndex = getStartIndex(wave);
-			if (bullets[startIndex]->getFlag() != ISCEILING)
+			if (bullets[startIndex].getFlag() != ISCEILING)
 				continue;
 			int endIndex = getEndIndex(wave);
 
-			int frameCount = waveFrameCount[wave];
+			int frameCount = getWaveFrameCount(wave);
 			// Ceiling starts going down
 			if (frameCount == CEILINGDROPDELAY)
 				for (int j = startIndex; j <= endIndex; j++) {
-					Bullet* bullet = bullets[j];
-					bullet->setVelocity(0, 2);
+					Bullet bullet = bullets[j];
+					bullet.setVelocity(0, 2);
 				}
 			// Decelerate at the last quarter before dropping
 			else if (frameCount > CEILINGDROPDELAY * 0.75f && frameCount < CEILINGDROPDELAY) {
 				// Calculate the initial speed for each bullet
 				float bulletSpeed = CEILINGBULLETINITIALSPEED * CEILINGBULLETSPACING;
-				int direction = (bullets[startIndex]->getVelocity().x < 0) ? -1 : 1;
+				int direction = (bullets[startIndex].getVelocity().x < 0) ? -1 : 1;
 				for (int j = startIndex; j <= endIndex; j++) {
-					Bullet* bullet = bullets[j];
-					bullet->adjustVelocity(-bulletSpeed * 4 * direction / CEILINGDROPDELAY, 0);
+					Bullet bullet = bullets[j];
+					bullet.adjustVelocity(-bulletSpeed * 4 * direction / CEILINGDROPDELAY, 0);
 					bulletSpeed += CEILINGBULLETSPACING;
 				}
 			}
@@ -843,36 +1027,434 @@ public:
 	}
 };
 
+// One instruction of a compiled pattern script. Arguments are stored as floats whatever their meaning
+struct ScriptInstruction {
+	char opcode; // See script constants
+	float args[3];
+};
+// Change applied every frame to each wave whose age is within [firstFrame, lastFrame]
+struct ScriptRule {
+	char opcode; // See script constants
+	int firstFrame, lastFrame;
+	float value;
+	sf::Vector2f rotation; // Precomputed rotation factor for SCRIPTROTATE
+};
+
+// Compile a pattern script into a flat instruction stream and a list of wave rules.
+// A script has one command per line. Text after # is ignored. Angles are in degrees and times in frames.
+//   source x y            Emit from this position. Defaults to the pattern's source position
+//   randomsource w h      Emit from a random position within a w by h box around the source
+//   angle a / turn a      Set / add to the angle of the first bullet of the next ring
+//   randomangle           Pick a random angle for the next ring
+//   speed s               Speed of emitted bullets
+//   bullet type           circle, rice, dot, talisman, bubble or arrowhead
+//   color r g b           Color of emitted bullets
+//   reverse               Toggle reversed rotation for the next rings
+//   ring n                Emit n bullets evenly around a circle as one wave
+//   wait n                Resume the script n frames later
+//   loop n ... end        Repeat the enclosed commands n times, or forever if n is 0
+// Wave rules are not part of the stream and apply to every wave by its age:
+//   rotate from to a      Turn bullets by a per frame. Reversed bullets turn the other way
+//   accelerate from to s  Add s to the speed per frame
+//   setspeed at s         Set the speed once
+// Counts, waits and frames cannot be negative, colors are 0 to 255, and a ring has at most SCRIPTMAXRINGBULLETS bullets.
+// Prints the first error and returns false
+inline bool compileScript(const string& script, vector<ScriptInstruction>& program, vector<ScriptRule>& rules) {
+	struct Command {
+		string name;
+		char opcode;
+		int argCount;
+		bool isRule;
+		// The first intArgCount arguments are counts, frames or color channels. They are converted to int when run,
+		// so they must be within [minimum, maximum]
+		int intArgCount;
+		int minimum, maximum;
+	};
+	static const vector<Command> COMMANDS = {
+		{ "source", SCRIPTSOURCE, 2, false }, { "randomsource", SCRIPTRANDOMSOURCE, 2, false }, { "angle", SCRIPTANGLE, 1, false },
+		{ "turn", SCRIPTTURN, 1, false }, { "randomangle", SCRIPTRANDOMANGLE, 0, false }, { "speed", SCRIPTSPEED, 1, false },
+		{ "bullet", SCRIPTBULLET, 1, false }, { "color", SCRIPTCOLOR, 3, false, 3, 0, 255 }, { "reverse", SCRIPTREVERSE, 0, false },
+		{ "ring", SCRIPTRING, 1, false, 1, 1, SCRIPTMAXRINGBULLETS }, { "wait", SCRIPTWAIT, 1, false, 1, 0, SCRIPTMAXCOUNT },
+		{ "loop", SCRIPTLOOP, 1, false, 1, 0, SCRIPTMAXCOUNT }, { "end", SCRIPTEND, 0, false },
+		{ "rotate", SCRIPTROTATE, 3, true, 2, 0, SCRIPTMAXCOUNT }, { "accelerate", SCRIPTACCELERATE, 3, true, 2, 0, SCRIPTMAXCOUNT },
+		{ "setspeed", SCRIPTSETSPEED, 2, true, 1, 0, SCRIPTMAXCOUNT }
+	};
+	static const vector<string> BULLETTYPENAMES = { "circle", "rice", "dot", "talisman", "bubble", "arrowhead" };
+	program.clear();
+	rules.clear();
+	vector<int> openLoops; // Indices of loop instructions without an end yet
+	istringstream lines(script);
+	string line;
+	for (int lineNumber = 1; getline(lines, line); lineNumber++) {
+		istringstream tokens(line.substr(0, line.find('#')));
+		string name;
+		if (!(tokens >> name))
+			continue;
+		auto command = find_if(COMMANDS.begin(), COMMANDS.end(), [&name](const Command& command) { return command.name == name; });
+		if (command == COMMANDS.end()) {
+			cout << "Script error on line " << lineNumber << ": unknown command " << name << "\n";
+			return false;
+		}
+		ScriptInstruction instruction = { command->opcode, { 0, 0, 0 } };
+		for (int i = 0; i < command->argCount; i++) {
+			string arg;
+			tokens >> arg;
+			if (command->opcode == SCRIPTBULLET) {
+				auto type = find(BULLETTYPENAMES.begin(), BULLETTYPENAMES.end(), arg);
+				if (type != BULLETTYPENAMES.end()) {
+					instruction.args[i] = type - BULLETTYPENAMES.begin();
+					continue;
+				}
+			}
+			else if (!arg.empty()) { // The whole token must be a finite float
+				char* end;
+				errno = 0;
+				float value = strtof(arg.c_str(), &end);
+				bool inRange = i >= command->intArgCount || (value >= command->minimum && value <= command->maximum);
+				if (*end == '\0' && errno != ERANGE && isfinite(value) && inRange) {
+					instruction.args[i] = i < command->intArgCount ? int(value) : value;
+					continue;
+				}
+			}
+			cout << "Script error on line " << lineNumber << ": bad argument " << i + 1 << " to " << name << "\n";
+			return false;
+		}
+		if (command->isRule) {
+			ScriptRule rule = { command->opcode, int(instruction.args[0]), int(instruction.args[1]), instruction.args[2] };
+			if (command->opcode == SCRIPTSETSPEED) { // Only one frame
+				rule.lastFrame = rule.firstFrame;
+				rule.value = instruction.args[1];
+			}
+			rule.rotation = getRotationFactor(rule.value);
+			rules.push_back(rule);
+			continue;
+		}
+		if (command->opcode == SCRIPTLOOP)
+			openLoops.push_back(program.size());
+		else if (command->opcode == SCRIPTEND) {
+			if (openLoops.empty()) {
+				cout << "Script error on line " << lineNumber << ": end without loop\n";
+				return false;
+			}
+			instruction.args[0] = openLoops.back(); // Index of the loop instruction to jump back to
+			openLoops.pop_back();
+		}
+		program.push_back(instruction);
+	}
+	if (!openLoops.empty()) {
+		cout << "Script error: loop without end\n";
+		return false;
+	}
+	return true;
+}
+
+// Pattern described by a script instead of code. See compileScript for the format.
+// Spawning runs the instruction stream until it waits, emitting each ring in one batch as its own wave.
+// Movement applies the wave rules to whole waves at once, then moves every bullet in a straight line
+class ScriptedPattern : public WavePattern {
+	vector<ScriptInstruction> program;
+	vector<ScriptRule> rules;
+	// Interpreter state
+	int programCounter;
+	int resumeFrame; // Frame to continue after a wait
+	vector<int> loops; // Remaining repeats of each loop being run. Zero repeats loops forever
+	// Emission state
+	sf::Vector2f emitSource, sourceVariance;
+	float emitAngle, emitSpeed;
+	char emitType;
+	sf::Color emitColor;
+	bool reversed;
+
+	// Default color and sprite radius of each bullet type, in bullet type order
+	sf::Color getDefaultColor(char type) {
+		static const vector<sf::Color> COLORS = { DEFAULTCIRCLEBULLETCOLOR, DEFAULTRICEBULLETCOLOR, DEFAULTDOTBULLETCOLOR,
+			DEFAULTTALISMANBULLETCOLOR, DEFAULTBUBBLEBULLETCOLOR, DEFAULTARROWHEADBULLETCOLOR };
+		return COLORS[type];
+	}
+	int getDefaultRadius(char type) {
+		static const vector<float> RADII = { STANDARDCIRCLEBULLETRADIUS, STANDARDRICEBULLETRADIUS, STANDARDDOTBULLETRADIUS,
+			STANDARDTALISMANBULLETRADIUS, STANDARDBUBBLEBULLETRADIUS, STANDARDARROWHEADBULLETRADIUS };
+		return RADII[type];
+	}
+	void emitRing(int count) {
+		sf::Vector2f position = emitSource;
+		if (sourceVariance.x > 0 && sourceVariance.y > 0)
+			position += sf::Vector2f(random.nextInt(sourceVariance.x) - sourceVariance.x / 2, random.nextInt(sourceVariance.y) - sourceVariance.y / 2);
+		int start = bullets.size();
+		bullets.addRing(emitType, position, emitSpeed, emitAngle, count, emitColor, getDefaultRadius(emitType));
+		if (reversed)
+			fill(bullets.getData().flags.begin() + start, bullets.getData().flags.end(), REVERSEROTATION);
+		addWave(count);
+	}
+	// Run one instruction. Returns false if the script has to stop for this frame
+	bool step(const ScriptInstruction& instruction) {
+		const float* args = instruction.args;
+		switch (instruction.opcode) {
+		case SCRIPTSOURCE:
+			emitSource = { args[0], args[1] };
+			break;
+		case SCRIPTRANDOMSOURCE:
+			sourceVariance = { args[0], args[1] };
+			break;
+		case SCRIPTANGLE:
+			emitAngle = args[0];
+			break;
+		case SCRIPTTURN:
+			emitAngle += args[0];
+			break;
+		case SCRIPTRANDOMANGLE:
+			emitAngle = random.nextInt(360);
+			break;
+		case SCRIPTSPEED:
+			emitSpeed = args[0];
+			break;
+		case SCRIPTBULLET:
+			emitType = args[0];
+			emitColor = getDefaultColor(emitType);
+			break;
+		case SCRIPTCOLOR:
+			emitColor = sf::Color(int(args[0]), int(args[1]), int(args[2]));
+			break;
+		case SCRIPTREVERSE:
+			reversed = !reversed;
+			break;
+		case SCRIPTRING:
+			emitRing(int(args[0]));
+			break;
+		case SCRIPTWAIT:
+			resumeFrame = frameCounter + int(args[0]);
+			programCounter++;
+			return false;
+		case SCRIPTLOOP:
+			loops.push_back(int(args[0]));
+			break;
+		case SCRIPTEND: {
+			int& repeats = loops.back();
+			if (repeats == 0 || --repeats > 0) {
+				programCounter = int(args[0]) + 1;
+				return true;
+			}
+			loops.pop_back();
+			break;
+		}
+		}
+		programCounter++;
+		return true;
+	}
+	void resetInterpreter() {
+		programCounter = 0;
+		resumeFrame = 0;
+		loops.clear();
+		emitSource = sourcePos;
+		sourceVariance = { 0, 0 };
+		emitAngle = 0;
+		emitSpeed = baseSpeed;
+		emitType = CIRCLEBULLET;
+		emitColor = DEFAULTCIRCLEBULLETCOLOR;
+		reversed = false;
+	}
+public:
+	// An invalid script gives a pattern that does nothing
+	ScriptedPattern(sf::Vector2f sourcePos, const string& script, float baseSpeed = 1)
+		: WavePattern(sourcePos, 0, 0, baseSpeed) {
+		if (!compileScript(script, program, rules)) {
+			program.clear();
+			rules.clear();
+		}
+		resetInterpreter();
+	}
+	void spawnBullets() {
+		for (int steps = 0; steps < SCRIPTSTEPLIMIT && frameCounter >= resumeFrame && programCounter < program.size(); steps++)
+			if (!step(program[programCounter]))
+				break;
+	}
+	void processMovement() {
+		incrementWaveFrames();
+		BulletData& data = bullets.getData();
+		forEachWaveChunk(0, [&](int wave, int begin, int end) {
+			int frameCount = getWaveFrameCount(wave);
+			for (const ScriptRule& rule : rules) {
+				if (frameCount < rule.firstFrame || frameCount > rule.lastFrame)
+					continue;
+				switch (rule.opcode) {
+				case SCRIPTROTATE:
+					for (int i = begin; i < end; i++) {
+						float sine = data.flags[i] == REVERSEROTATION ? -rule.rotation.y : rule.rotation.y;
+						float x = data.dirX[i];
+						data.dirX[i] = x * rule.rotation.x - data.dirY[i] * sine;
+						data.dirY[i] = x * sine + data.dirY[i] * rule.rotation.x;
+					}
+					break;
+				case SCRIPTACCELERATE:
+					for (int i = begin; i < end; i++)
+						data.speeds[i] += rule.value;
+					break;
+				case SCRIPTSETSPEED:
+					fill(data.speeds.begin() + begin, data.speeds.begin() + end, rule.value);
+					break;
+				}
+			}
+			bullets.moveBullets(begin, end);
+		});
+		bullets.processLasers();
+	}
+	void resetPattern() {
+		Pattern::resetPattern();
+		resetInterpreter();
+	}
+	// The program and rules come from the script, so only the interpreter and emission state are saved
+	void saveState(StateWriter& writer) {
+		WavePattern::saveState(writer);
+		writer.write(programCounter);
+		writer.write(resumeFrame);
+		writer.write(uint32_t(loops.size()));
+		for (int repeats : loops)
+			writer.write(repeats);
+		writer.write(emitSource);
+		writer.write(sourceVariance);
+		writer.write(emitAngle);
+		writer.write(emitSpeed);
+		writer.write(emitType);
+		writer.write(emitColor);
+		writer.write(reversed);
+	}
+	bool loadState(StateReader& reader) {
+		if (!WavePattern::loadState(reader))
+			return false;
+		reader.read(programCounter);
+		reader.read(resumeFrame);
+		uint32_t loopCount = 0;
+		reader.read(loopCount);
+		loops.clear();
+		for (uint32_t i = 0; i < loopCount && !reader.getFailed(); i++) {
+			int repeats = 0;
+			reader.read(repeats);
+			loops.push_back(repeats);
+		}
+		reader.read(emitSource);
+		reader.read(sourceVariance);
+		reader.read(emitAngle);
+		reader.read(emitSpeed);
+		reader.read(emitType);
+		reader.read(emitColor);
+		reader.read(reversed);
+		if (reader.getFailed() || programCounter < 0 || programCounter > program.size())
+			return false;
+		// The bullet type indexes the default colors and radii, and every open loop needs its entry on the loop stack
+		int openLoops = 0;
+		for (int i = 0; i < programCounter; i++) {
+			if (program[i].opcode == SCRIPTLOOP)
+				openLoops++;
+			else if (program[i].opcode == SCRIPTEND)
+				openLoops--;
+		}
+		return emitType >= CIRCLEBULLET && emitType <= ARROWHEADBULLET && openLoops == loops.size();
+	}
+};
+
 // Manager for all patterns. Will be called by main, GameScreen, and others.
 class PatternManager : public sf::Drawable {
 	vector<Pattern*> activePatterns;
+	ThreadPool* threadPool; // Updates patterns in parallel if set
+	uint64_t seed; // Master seed. Each pattern's generator uses it with the pattern's index as its stream
+	BulletAtlas atlas; // Sprites of every pattern's bullets, shared so each style is only rasterized once
+	FrameProfiler* profiler; // Times every update phase if set
 
 	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
 		for (Pattern* pattern : activePatterns)
 			target.draw(*pattern, states);
 	}
+	// Delete, spawn, and move the bullets of one pattern
+	void updatePattern(int index) {
+		Pattern* pattern = activePatterns[index];
+		if (pattern->getActive()) {
+			TRACE_SCOPE_DETAIL("updatePattern", getPatternName(index));
+			PhaseTimer timer(profiler ? profiler->getPatternTimings(index).phases : nullptr);
+			{
+				ALLOC_PATTERN_SCOPE(ALLOCCULL, index);
+				pattern->getBullets().savePositions();
+				pattern->deleteOutOfBoundsBullets();
+			}
+			timer.lap(DELETEPHASE);
+			{
+				TRACE_SCOPE_DETAIL("spawnBullets", getPatternName(index));
+				ALLOC_PATTERN_SCOPE(ALLOCSPAWN, index);
+				pattern->spawnBullets();
+				pattern->incrementFrame();
+			}
+			timer.lap(SPAWNPHASE);
+			{
+				TRACE_SCOPE_DETAIL("processMovement", getPatternName(index));
+				ALLOC_PATTERN_SCOPE(ALLOCMOVE, index);
+				pattern->processMovement();
+			}
+			timer.lap(MOVEPHASE);
+			{
+				ALLOC_PATTERN_SCOPE(ALLOCCOLLIDE, index);
+				pattern->binBullets();
+			}
+			timer.lap(BINPHASE);
+		}
+		if (profiler)
+			profiler->getPatternTimings(index).bulletCount = pattern->getActive() ? pattern->getBullets().size() : 0;
+	}
 public:
-	PatternManager() {}
+	PatternManager(uint64_t seed = 0) {
+		this->seed = seed;
+		threadPool = nullptr;
+		profiler = nullptr;
+	}
 	~PatternManager() {
 		for (Pattern* pattern : activePatterns)
 			delete pattern;
+		delete threadPool;
 	}
 	// Adds a pattern to the manager. Patterns can either spawn bullets from an algorithm or function call.
 	void addPattern(Pattern* pattern) {
+		pattern->getBullets().setAtlas(&atlas);
+		pattern->setThreadPool(threadPool);
+		pattern->getRandom().setSeed(seed, activePatterns.size());
 		activePatterns.push_back(pattern);
+		if (profiler)
+			profiler->setPatternCount(activePatterns.size());
 	}
-	// Call every frame. Delete, spawn, and move bullets
+	// Call every frame. Delete, spawn, and move bullets.
+	// Patterns only touch their own bullets and random generator, so they can be updated in parallel with the same result.
+	// Large patterns also split their bullet loops across the same pool
 	void update() {
-		for (Pattern* pattern : activePatterns) {
-			if (pattern->getActive()) {
-				pattern->deleteOutOfBoundsBullets();
-				pattern->spawnBullets();
-				pattern->incrementFrame();
-				pattern->processMovement();
-			}
-		}
+		TRACE_SCOPE("PatternManager::update");
+		if (threadPool)
+			threadPool->parallelFor(activePatterns.size(), [this](int i) { updatePattern(i); });
+		else
+			for (int i = 0; i < activePatterns.size(); i++)
+				updatePattern(i);
+	}
+	// Record update and collision timings into a profiler. Pass null to stop
+	void setProfiler(FrameProfiler* profiler) {
+		this->profiler = profiler;
+		if (profiler)
+			profiler->setPatternCount(activePatterns.size());
+	}
+	FrameProfiler* getProfiler() {
+		return profiler;
+	}
+	// Number of threads used by update, including the calling thread. 1 updates patterns one after another
+	void setThreadCount(int threadCount) {
+		delete threadPool;
+		threadPool = threadCount > 1 ? new ThreadPool(threadCount - 1) : nullptr;
+		for (Pattern* pattern : activePatterns)
+			pattern->setThreadPool(threadPool);
+	}
+	int getThreadCount() {
+		return threadPool ? threadPool->getThreadCount() : 1;
 	}
-	// Deactive all patterns and reset their counters
+	// Deactivate every pattern, then activate the one at index if there is one
+	void selectPattern(int index) {
+		deactivateAllPatterns();
+		if (index >= 0 && index < activePatterns.size())
+			activePatterns[index]->setActive(true);
+	}
+	// Deactive all patterns and reset their counters. Bullet arenas are emptied but keep their storage
 	void deactivateAllPatterns() {
 		for (int i = 0; i < activePatterns.size(); i++) {
 			activePatterns[i]->setActive(false);
@@ -881,25 +1463,139 @@ public:
 				activePatterns[i]->deleteAllBullets();
 		}
 	}
+	// Draw bullets part of the way between the last two ticks. See BulletStore::setInterpolation
+	void setInterpolation(float interpolation) {
+		for (Pattern* pattern : activePatterns)
+			pattern->getBullets().setInterpolation(interpolation);
+	}
+	// Reseed every pattern from a new master seed
+	void setSeed(uint64_t seed) {
+		this->seed = seed;
+		for (int i = 0; i < activePatterns.size(); i++)
+			activePatterns[i]->getRandom().setSeed(seed, i);
+	}
+	BulletAtlas* getAtlas() {
+		return &atlas;
+	}
+	uint64_t getSeed() {
+		return seed;
+	}
 	void rotateAllBullets(float angleDegrees) {
 		for (Pattern* pattern : activePatterns)
-			for (Bullet* bullet : pattern->getBullets())
-				bullet->rotateBullet(angleDegrees);
+			pattern->getBullets().rotateAllBullets(angleDegrees);
 	}
-	// Check if player hitbox has collided with any bullets
-	bool checkPlayerCollision(sf::CircleShape& hitbox) {
+	// Save the seed and every pattern, each with the length of its state
+	void saveState(StateWriter& writer) {
+		writer.write(seed);
+		writer.write(uint32_t(activePatterns.size()));
+		for (Pattern* pattern : activePatterns) {
+			size_t start = writer.size();
+			writer.write(uint32_t(0));
+			pattern->saveState(writer);
+			writer.overwrite(start, uint32_t(writer.size() - start - sizeof(uint32_t)));
+		}
+	}
+	// Load state saved by a manager with the same patterns added in the same order. A pattern whose state has a different
+	// length was saved by another kind of pattern. On failure every pattern is deactivated, since some may be partly loaded
+	bool loadState(StateReader& reader) {
+		uint64_t savedSeed;
+		uint32_t patternCount;
+		bool loaded = reader.read(savedSeed) && reader.read(patternCount) && patternCount == activePatterns.size();
+		for (int i = 0; loaded && i < activePatterns.size(); i++) {
+			uint32_t length;
+			loaded = reader.read(length);
+			size_t start = reader.getPosition();
+			loaded = loaded && activePatterns[i]->loadState(reader) && reader.getPosition() - start == length;
+		}
+		if (!loaded) {
+			deactivateAllPatterns();
+			if (!activePatterns.empty()) // Test bullets too, since a partial load leaves arrays of different lengths
+				activePatterns[0]->deleteAllBullets();
+			return false;
+		}
+		seed = savedSeed;
+		// Collision checks can run before the next update bins the bullets
 		for (Pattern* pattern : activePatterns)
-			if (pattern->getActive())
-				for (Bullet* bullet : pattern->getBullets())
-					if (bullet->checkPlayerCollision(hitbox))
-						return true;
-		return false;
+			pattern->binBullets();
+		return true;
+	}
+	// Apply a pattern command from the player. Commands go through here so input logs can replay them
+	void applyCommand(char type, int value) {
+		if (type == SELECTPATTERNCOMMAND)
+			selectPattern(value);
+		else if (type == ROTATEBULLETSCOMMAND)
+			rotateAllBullets(value);
+	}
+	// Check if player hitbox has collided with any bullets. Every active pattern is checked, even after a hit,
+	// so each pattern's collision timings cover every frame
+	bool checkPlayerCollision(sf::CircleShape& hitbox) {
+		bool collided = false;
+		for (int i = 0; i < activePatterns.size(); i++) {
+			if (!activePatterns[i]->getActive())
+				continue;
+			PhaseTimer timer(profiler ? profiler->getPatternTimings(i).phases : nullptr);
+			ALLOC_PATTERN_SCOPE(ALLOCCOLLIDE, i);
+			collided |= activePatterns[i]->getBullets().checkPlayerCollision(hitbox);
+			timer.lap(COLLIDEPHASE);
+		}
+		return collided;
+	}
+	// Collect the bullets touching the player hitbox in each active pattern. hits[i] holds the bullet indices for pattern i
+	bool getPlayerCollisions(sf::CircleShape& hitbox, vector<vector<int>>& hits) {
+		bool collided = false;
+		hits.resize(activePatterns.size());
+		for (int i = 0; i < activePatterns.size(); i++) {
+			hits[i].clear();
+			if (activePatterns[i]->getActive())
+				collided |= activePatterns[i]->getBullets().getPlayerCollisions(hitbox, hits[i]);
+		}
+		return collided;
 	}
 	int getPatternCount() {
 		return activePatterns.size();
 	}
+	// Hash of which patterns are active and where their bullets are. See BulletStore::getChecksum
+	uint32_t getChecksum(uint32_t hash) {
+		for (Pattern* pattern : activePatterns) {
+			bool active = pattern->getActive();
+			hash = hashBytes(hash, &active, sizeof(active));
+			if (active)
+				hash = pattern->getBullets().getChecksum(hash);
+		}
+		return hash;
+	}
+	// Name shown in traces. Patterns are named by their index in PATTERNNAMES
+	const char* getPatternName(int index) {
+		return index < PATTERNNAMES.size() ? PATTERNNAMES[index].c_str() : "Pattern";
+	}
 	Pattern* operator[](int index) {
 		return activePatterns[index];
 	}
 };
 
+// Add a list of static bullets to the general pattern
+inline void addTestBullets(Pattern* generalBullets) {
+	generalBullets->addCircleBullet({ 350, 400 }, 0, 0);
+	generalBullets->addRiceBullet({ 400, 400 }, 0, 90);
+	generalBullets->addDotBullet({ 450, 400 }, 0, 0);
+	generalBullets->addTalismanBullet({ 500, 400 }, 0, 90);
+	generalBullets->addBubbleBullet({ 550, 400 }, 0, 0);
+	generalBullets->addLaser({ 400, 200 }, 0, 10, 20, 0.25, 99, BLUE);
+	generalBullets->addArrowheadBullet({600, 400}, 0, 90);
+	generalBullets->addSpawner({ 300, 400 }, 0, 0, true);
+}
+// Add every pattern in PATTERNNAMES order, all inactive
+inline void addStandardPatterns(PatternManager& manager) {
+	Pattern* generalBullets = new Pattern();
+	addTestBullets(generalBullets);
+	manager.addPattern(generalBullets);
+	manager.addPattern(new Bowap({ 400, 400 }, 8, 30, 6));
+	manager.addPattern(new QedRipples({ 400, 200 }, 80, 0.75, 3));
+	manager.addPattern(new FlyingSaucer({ 400, 250 }, 40, 0.35, 2));
+	manager.addPattern(new GengetsuTime({ 400, 200 }, 48, 10, 10));
+	manager.addPattern(new WindGod({ 400, 300 }, 0.3, 4));
+	manager.addPattern(new MercuryPoison({ 400, 200 }, 32, 3, 2.5));
+	manager.addPattern(new SeamlessCeiling({ 400, 200 }, 4, 2, 3));
+	manager.addPattern(new ScriptedPattern({ 400, 250 }, SCRIPTED::RINGSCRIPT));
+	manager.deactivateAllPatterns();
+}
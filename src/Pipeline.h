@@ -0,0 +1,171 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "Constants.h"
+#include "GameScreen.h"
+#include "Replay.h"
+using namespace std;
+using namespace Constants;
+
+// File to run the simulation on its own thread while the window thread draws the previous tick
+
+// Fixed-size ring buffer for one producer thread and one consumer thread. Neither side ever blocks
+template <typename T, int CAPACITY>
+class SpscQueue {
+	T items[CAPACITY];
+	atomic<int> head, tail; // Next item to pop and next slot to push. One slot stays empty to tell full from empty
+public:
+	SpscQueue() {
+		head = 0;
+		tail = 0;
+	}
+	// Returns false if the queue is full
+	bool push(const T& item) {
+		int slot = tail.load(memory_order_relaxed);
+		int next = (slot + 1) % CAPACITY;
+		if (next == head.load(memory_order_acquire))
+			return false;
+		items[slot] = item;
+		tail.store(next, memory_order_release);
+		return true;
+	}
+	// Returns false if the queue is empty
+	bool pop(T& item) {
+		int slot = head.load(memory_order_relaxed);
+		if (slot == tail.load(memory_order_acquire))
+			return false;
+		item = items[slot];
+		head.store((slot + 1) % CAPACITY, memory_order_release);
+		return true;
+	}
+};
+
+// Pattern command from the window thread, applied at the start of the next tick
+struct GameCommand {
+	char type; // See command constants
+	int value; // Pattern index or rotation angle
+};
+
+// Three frame snapshots rotated between a writer and a reader. The writer always has a spare snapshot to fill and the
+// reader keeps the one it is drawing, so neither side waits and neither sees a snapshot while it is being written
+class SnapshotBuffer {
+	static const int NEWSNAPSHOT = 4; // Set on the ready index until the reader takes it
+	FrameSnapshot snapshots[3];
+	atomic<int> ready; // Newest finished snapshot
+	int writing, reading; // Owned by the writer and the reader
+public:
+	SnapshotBuffer() {
+		writing = 0;
+		ready = 1;
+		reading = 2;
+	}
+	FrameSnapshot& getWriteSnapshot() {
+		return snapshots[writing];
+	}
+	// Swap the filled snapshot with the ready one
+	void publish() {
+		writing = ready.exchange(writing | NEWSNAPSHOT) & ~NEWSNAPSHOT;
+	}
+	// Take the newest finished snapshot. Returns false if nothing was published since the last call
+	bool acquire() {
+		if (!(ready.load() & NEWSNAPSHOT))
+			return false;
+		reading = ready.exchange(reading) & ~NEWSNAPSHOT;
+		return true;
+	}
+	const FrameSnapshot& getReadSnapshot() {
+		return snapshots[reading];
+	}
+};
+
+// Runs the game screen's fixed ticks on a separate thread. The window thread sends commands through a lock-free queue,
+// overwrites the held keys each frame, and draws the newest finished tick, so a frame takes the longer of simulating and drawing instead of both.
+// The game screen and its patterns must not be touched by the window thread while this runs, except for drawing snapshots
+class SimulationThread {
+	GameScreen* gameScreen;
+	PatternManager* manager;
+	SpscQueue<GameCommand, COMMANDQUEUESIZE> commands;
+	SnapshotBuffer snapshots;
+	atomic<unsigned char> latestInput; // PlayerInput mask of the keys held, overwritten by the window thread every frame
+	InputRecorder* recorder; // Logs every tick if set. Only used by the simulation thread
+	int hitCount;
+	atomic<bool> running;
+	thread worker;
+
+	void applyCommands() {
+		GameCommand command;
+		while (commands.pop(command)) {
+			manager->applyCommand(command.type, command.value);
+			if (recorder)
+				recorder->addCommand(command.type, command.value);
+		}
+	}
+	void publishSnapshot() {
+		TRACE_SCOPE("SimulationThread::publishSnapshot");
+		FrameSnapshot& snapshot = snapshots.getWriteSnapshot();
+		gameScreen->takeSnapshot(snapshot);
+		snapshot.hitCount = hitCount;
+		snapshot.tickTime = chrono::steady_clock::now();
+		snapshots.publish();
+	}
+	// Same fixed timestep as the single threaded loop, sleeping between ticks instead of waiting on the display
+	void run() {
+		chrono::steady_clock::time_point lastTime = chrono::steady_clock::now();
+		float tickAccumulator = 0;
+		while (running) {
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+			tickAccumulator += chrono::duration<float>(now - lastTime).count();
+			lastTime = now;
+			FrameProfiler* profiler = manager->getProfiler();
+			PhaseTimer updateTimer(profiler ? profiler->getStages() : nullptr);
+			int ticks = 0;
+			while (tickAccumulator >= TICKSECONDS && ticks < MAXTICKSPERFRAME) {
+				applyCommands();
+				PlayerInput input = PlayerInput::fromMask(latestInput.load(memory_order_relaxed));
+				if (gameScreen->simulate(input))
+					hitCount++;
+				if (recorder)
+					recorder->recordTick(input, gameScreen->getChecksum());
+				tickAccumulator -= TICKSECONDS;
+				ticks++;
+			}
+			if (ticks > 0)
+				updateTimer.lap(UPDATESTAGE); // Every tick of the batch as one sample, like the single threaded loop
+			if (ticks == MAXTICKSPERFRAME)
+				tickAccumulator = min(tickAccumulator, TICKSECONDS);
+			if (ticks > 0)
+				publishSnapshot();
+			this_thread::sleep_for(chrono::duration<float>(TICKSECONDS - tickAccumulator));
+		}
+	}
+public:
+	// The recorder, if given, must outlive the thread
+	SimulationThread(GameScreen* gameScreen, PatternManager* manager, InputRecorder* recorder = nullptr) {
+		this->gameScreen = gameScreen;
+		this->manager = manager;
+		this->recorder = recorder;
+		latestInput = 0;
+		hitCount = 0;
+		publishSnapshot(); // There is always a tick to draw, so the window thread never reads the live state
+		running = true;
+		worker = thread(&SimulationThread::run, this);
+	}
+	~SimulationThread() {
+		running = false;
+		worker.join();
+	}
+	// Called from the window thread. Returns false if the simulation has fallen too far behind to take more commands
+	bool sendCommand(char type, int value) {
+		return commands.push({ type, value });
+	}
+	// Called from the window thread. Every tick uses the keys from the latest call, so no key state is queued
+	void setInput(PlayerInput input) {
+		latestInput.store(input.toMask(), memory_order_relaxed);
+	}
+	// Called from the window thread. Returns the newest finished tick, which stays valid until the next call
+	const FrameSnapshot* getLatestSnapshot() {
+		snapshots.acquire();
+		return &snapshots.getReadSnapshot();
+	}
+};
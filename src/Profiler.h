@@ -0,0 +1,180 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include "Constants.h"
+#include "Drawings.h"
+using namespace std;
+using namespace Constants;
+
+// File to time the stages of a frame and the phases of each pattern's update
+
+// Ring buffer of the latest durations of one stage, in microseconds. One thread writes and any thread may read.
+// Samples are relaxed atomics, so recording costs a clock read and a store and never blocks
+class TimingBuffer {
+	atomic<float> samples[TIMINGSAMPLES];
+	atomic<int> next; // Slot of the next sample
+	atomic<int> count; // Samples stored, up to TIMINGSAMPLES
+public:
+	TimingBuffer() {
+		for (atomic<float>& sample : samples)
+			sample.store(0, memory_order_relaxed);
+		next = 0;
+		count = 0;
+	}
+	void add(float microseconds) {
+		int slot = next.load(memory_order_relaxed);
+		samples[slot].store(microseconds, memory_order_relaxed);
+		next.store((slot + 1) % TIMINGSAMPLES, memory_order_relaxed);
+		if (count.load(memory_order_relaxed) < TIMINGSAMPLES)
+			count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+	}
+	// Copy the stored samples into out, in no particular order
+	void getSamples(vector<float>& out) const {
+		out.resize(count.load(memory_order_relaxed));
+		for (int i = 0; i < out.size(); i++)
+			out[i] = samples[i].load(memory_order_relaxed);
+	}
+};
+
+// Median, 99th percentile and maximum of a set of samples
+struct TimingStats {
+	float p50, p99, max;
+};
+// Reorders samples. All zero if there are none
+inline TimingStats getTimingStats(vector<float>& samples) {
+	if (samples.empty())
+		return { 0, 0, 0 };
+	auto at = [&samples](float fraction) {
+		auto position = samples.begin() + int(fraction * (samples.size() - 1));
+		nth_element(samples.begin(), position, samples.end());
+		return *position;
+	};
+	return { at(0.5f), at(0.99f), at(1) };
+}
+
+// Records the time between laps into an array of buffers. Does nothing if the array is null, so code can be timed unconditionally
+class PhaseTimer {
+	TimingBuffer* buffers;
+	chrono::steady_clock::time_point lapStart;
+public:
+	PhaseTimer(TimingBuffer* buffers) {
+		this->buffers = buffers;
+		if (buffers)
+			lapStart = chrono::steady_clock::now();
+	}
+	// Add the time since the last lap to buffers[index] and start the next lap
+	void lap(int index) {
+		if (!buffers)
+			return;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		buffers[index].add(chrono::duration<float, micro>(now - lapStart).count());
+		lapStart = now;
+	}
+};
+
+// Timings of one pattern. See the phase constants
+struct PatternTimings {
+	TimingBuffer phases[PHASECOUNT];
+	atomic<int> bulletCount;
+	PatternTimings() {
+		bulletCount = 0;
+	}
+};
+
+// Collects frame stage timings and per-pattern phase timings. Cheap enough to leave on: a few clock reads per pattern per tick
+class FrameProfiler {
+	TimingBuffer stages[STAGECOUNT];
+	vector<unique_ptr<PatternTimings>> patterns;
+	chrono::steady_clock::time_point lastFrame;
+	bool hasFrame;
+public:
+	FrameProfiler() {
+		hasFrame = false;
+	}
+	// Call at the start of every rendered frame. Records the time since the previous call as the frame time
+	void markFrame() {
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (hasFrame)
+			stages[FRAMESTAGE].add(chrono::duration<float, micro>(now - lastFrame).count());
+		lastFrame = now;
+		hasFrame = true;
+	}
+	// Must not be called while patterns are being updated
+	void setPatternCount(int count) {
+		while (patterns.size() < count)
+			patterns.push_back(unique_ptr<PatternTimings>(new PatternTimings()));
+	}
+	int getPatternCount() {
+		return patterns.size();
+	}
+	TimingBuffer* getStages() {
+		return stages;
+	}
+	PatternTimings& getPatternTimings(int index) {
+		return *patterns[index];
+	}
+};
+
+// Text overlay of the profiler's statistics: p50/p99/max of each frame stage, then the bullet count and p99 of each phase
+// for every pattern with bullets. Statistics are only recomputed every PROFILERREFRESHSECONDS while shown
+class ProfilerOverlay : public sf::Drawable {
+	FrameProfiler* profiler;
+	SfTextAtHome text;
+	sfClockAtHome refreshTimer;
+	vector<float> scratch;
+	bool visible;
+
+	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
+		if (visible)
+			target.draw(text, states);
+	}
+	TimingStats getStats(const TimingBuffer& buffer) {
+		buffer.getSamples(scratch);
+		return getTimingStats(scratch);
+	}
+public:
+	ProfilerOverlay(FrameProfiler* profiler, sf::Font& font) {
+		this->profiler = profiler;
+		text = SfTextAtHome(font, WHITE, "", 14, PROFILERTEXTPOS, false);
+		visible = false;
+	}
+	void toggle() {
+		visible = !visible;
+		refreshTimer.restart();
+		refresh();
+	}
+	// Call every frame. Cheap unless the overlay is shown and due for a refresh
+	void update() {
+		if (!visible || refreshTimer.getTimeSeconds() < PROFILERREFRESHSECONDS)
+			return;
+		refreshTimer.restart();
+		refresh();
+	}
+	void refresh() {
+		ostringstream out;
+		out << fixed << setprecision(2) << "ms          p50     p99     max\n";
+		for (int stage = 0; stage < STAGECOUNT; stage++) {
+			TimingStats stats = getStats(profiler->getStages()[stage]);
+			out << left << setw(10) << STAGELABELS[stage] << right << setw(7) << stats.p50 / 1000 << " " << setw(7) << stats.p99 / 1000
+				<< " " << setw(7) << stats.max / 1000 << "\n";
+		}
+		out << "\npattern p99 ms";
+		for (const string& label : PHASELABELS)
+			out << " " << setw(6) << label;
+		out << "\n";
+		for (int i = 0; i < profiler->getPatternCount(); i++) {
+			PatternTimings& timings = profiler->getPatternTimings(i);
+			int bulletCount = timings.bulletCount;
+			if (bulletCount == 0)
+				continue;
+			out << left << setw(7) << (i < PATTERNNAMES.size() ? PATTERNNAMES[i] : to_string(i)) << right << setw(6) << bulletCount << "  ";
+			for (int phase = 0; phase < PHASECOUNT; phase++)
+				out << " " << setw(6) << getStats(timings.phases[phase]).p99 / 1000;
+			out << "\n";
+		}
+		text.setString(out.str());
+	}
+};
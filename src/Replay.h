@@ -0,0 +1,135 @@
+#pragma once
+#include <fstream>
+#include <cstdint>
+#include "Constants.h"
+#include "GameScreen.h"
+using namespace std;
+using namespace Constants;
+
+// File to record the player's input as a compact binary log and play it back tick by tick.
+// Patterns are seeded, so the seed, the pattern commands, and the keys held on every tick are enough to repeat a run.
+// Layout, with integers little endian:
+//   header: REPLAYMAGIC, REPLAYVERSION byte, seed (8 bytes)
+//   per tick: input mask byte (PlayerInput::toMask, plus REPLAYCOMMANDSBIT if commands follow),
+//     if commands follow: command count (2 bytes), then per command: type byte, value (4 bytes),
+//     checksum of the state after the tick (4 bytes). See GameScreen::getChecksum
+
+template <typename T>
+void writeLogValue(ofstream& file, T value) {
+	for (int i = 0; i < sizeof(T); i++)
+		file.put(char(uint64_t(value) >> (8 * i)));
+}
+// Returns false at the end of the file
+template <typename T>
+bool readLogValue(ifstream& file, T& value) {
+	uint64_t bits = 0;
+	for (int i = 0; i < sizeof(T); i++) {
+		int byte = file.get();
+		if (byte == EOF)
+			return false;
+		bits |= uint64_t(byte) << (8 * i);
+	}
+	value = T(bits);
+	return true;
+}
+
+// Pattern command logged with the tick it was applied before
+struct LoggedCommand {
+	char type;
+	int value;
+};
+
+// Writes an input log while the game runs. Commands are held until the next tick is recorded
+class InputRecorder {
+	ofstream file;
+	vector<LoggedCommand> pendingCommands;
+public:
+	InputRecorder(const string& path, uint64_t seed) : file(path, ios::binary) {
+		file.write(REPLAYMAGIC.data(), REPLAYMAGIC.size());
+		writeLogValue(file, REPLAYVERSION);
+		writeLogValue(file, seed);
+	}
+	bool isOpen() {
+		return file.good();
+	}
+	// Call right after the command is applied
+	void addCommand(char type, int value) {
+		pendingCommands.push_back({ type, value });
+	}
+	// Call after every tick with the keys it used and GameScreen::getChecksum
+	void recordTick(const PlayerInput& input, uint32_t checksum) {
+		unsigned char mask = input.toMask();
+		if (pendingCommands.empty())
+			writeLogValue(file, mask);
+		else {
+			writeLogValue(file, (unsigned char)(mask | REPLAYCOMMANDSBIT));
+			writeLogValue(file, uint16_t(pendingCommands.size()));
+			for (const LoggedCommand& command : pendingCommands) {
+				writeLogValue(file, command.type);
+				writeLogValue(file, int32_t(command.value));
+			}
+			pendingCommands.clear();
+		}
+		writeLogValue(file, checksum);
+	}
+};
+
+// Reads an input log and feeds it to a game screen one tick at a time.
+// Every tick's checksum is compared with the logged one, so a replay on another build shows the first tick that differs
+class InputReplay {
+	ifstream file;
+	uint64_t seed;
+	bool valid;
+	int tick; // Ticks played so far
+	int firstDivergedTick; // -1 while every checksum has matched
+public:
+	InputReplay(const string& path) : file(path, ios::binary) {
+		seed = 0;
+		tick = 0;
+		firstDivergedTick = -1;
+		string magic(REPLAYMAGIC.size(), '\0');
+		char version = 0;
+		valid = file.read(&magic[0], magic.size()) && magic == REPLAYMAGIC && readLogValue(file, version) && version == REPLAYVERSION
+			&& readLogValue(file, seed);
+	}
+	// False if the file could not be opened, is not an input log, or was written by an incompatible version
+	bool isValid() {
+		return valid;
+	}
+	// Patterns must be seeded with this before the first tick
+	uint64_t getSeed() {
+		return seed;
+	}
+	// Apply the next tick's commands and run it. Returns false at the end of the log. Sets hit if the player was hit
+	bool playTick(GameScreen& gameScreen, PatternManager& manager, bool& hit) {
+		unsigned char mask;
+		if (!valid || !readLogValue(file, mask))
+			return false;
+		if (mask & REPLAYCOMMANDSBIT) {
+			uint16_t count;
+			if (!readLogValue(file, count))
+				return false;
+			for (int i = 0; i < count; i++) {
+				char type;
+				int32_t value;
+				if (!readLogValue(file, type) || !readLogValue(file, value))
+					return false;
+				manager.applyCommand(type, value);
+			}
+		}
+		uint32_t checksum;
+		if (!readLogValue(file, checksum))
+			return false;
+		hit = gameScreen.simulate(PlayerInput::fromMask(mask & ~REPLAYCOMMANDSBIT));
+		if (firstDivergedTick < 0 && gameScreen.getChecksum() != checksum)
+			firstDivergedTick = tick;
+		tick++;
+		return true;
+	}
+	int getTick() {
+		return tick;
+	}
+	int getFirstDivergedTick() {
+		return firstDivergedTick;
+	}
+};
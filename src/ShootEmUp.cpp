@@ -10,25 +10,70 @@
 #include "Constants.h"
 #include "Drawings.h"
 #include "Mechanisms.h"
+#include "ThreadPool.h"
+#include "Collision.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "AllocTracker.h"
 #include "Bullet.h"
 #include "Pattern.h"
 #include "GameScreen.h"
 #include "Characters.h"
+#include "Pipeline.h"
+#include "Replay.h"
 using namespace std;
 using namespace Constants;
-// Add a list of static bullets to the general pattern
-void addTestBullets(Pattern* generalBullets) {
-    generalBullets->addCircleBullet({ 350, 400 }, 0, 0);
-    generalBullets->addRiceBullet({ 400, 400 }, 0, 90);
-    generalBullets->addDotBullet({ 450, 400 }, 0, 0);
-    generalBullets->addTalismanBullet({ 500, 400 }, 0, 90);
-    generalBullets->addBubbleBullet({ 550, 400 }, 0, 0);
-    generalBullets->addLaser({ 400, 200 }, 0, 10, 20, 0.25, 99, BLUE);
-    generalBullets->addArrowheadBullet({600, 400}, 0, 90);
-    generalBullets->addSpawner({ 300, 400 }, 0, 0, true);
-}
-int main(){
-    srand(time(NULL));
+// Optional arguments: master seed for the patterns, which uses the current time if not given,
+// and --pipelined to simulate on a separate thread from drawing. F3 shows frame timings.
+// --record <file> writes an input log of the session. --replay <file> plays one back instead of reading the keyboard,
+// using the log's seed. ShootEmUpHeadless --replay plays logs without a window at full speed.
+// --load-state <file> starts from a state file. F5 saves the state to STATEFILEPATH and F9 loads it, when not pipelined.
+// Builds with SHOOTEMUP_TRACE write a Chrome trace of the session on exit or F4.
+// Builds with SHOOTEMUP_ALLOCTRACK show heap allocations per frame next to the fps and write a report on exit
+int main(int argc, char* argv[]){
+    uint64_t seed = time(NULL);
+    bool pipelined = false;
+    string recordPath, replayPath, statePath;
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--pipelined")
+            pipelined = true;
+        else if (string(argv[i]) == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (string(argv[i]) == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (string(argv[i]) == "--load-state" && i + 1 < argc)
+            statePath = argv[++i];
+        else if (string(argv[i]).find_first_not_of("0123456789") == string::npos && argv[i][0] != '\0')
+            seed = strtoull(argv[i], nullptr, 10);
+        else {
+            cout << "Unknown argument " << argv[i] << "\n";
+            cout << "Usage: " << argv[0] << " [seed] [--pipelined] [--record <file> | --replay <file> | --load-state <file>]\n";
+            return -1;
+        }
+    }
+    if (!statePath.empty() && (!recordPath.empty() || !replayPath.empty())) {
+        cout << "Input logs start from the beginning, so they cannot be used with --load-state\n";
+        return -1;
+    }
+    InputReplay* replay = nullptr;
+    if (!replayPath.empty()) {
+        replay = new InputReplay(replayPath);
+        if (!replay->isValid()) {
+            cout << "Failed to read input log " << replayPath << "\n";
+            return -1;
+        }
+        seed = replay->getSeed();
+        pipelined = false; // Replays tick on the window thread so they can be checked tick by tick
+    }
+    InputRecorder* recorder = nullptr;
+    if (!recordPath.empty()) {
+        recorder = new InputRecorder(recordPath, seed);
+        if (!recorder->isOpen()) {
+            cout << "Failed to open input log " << recordPath << "\n";
+            return -1;
+        }
+    }
+    cout << "Seed: " << seed << "\n";
     // Load sprite textures
     sf::Texture playerTexture;
     if (!playerTexture.loadFromFile(PLAYERTEXTUREFILEPATH)) {
@@ -49,47 +94,113 @@ int main(){
     windowSettings.antialiasingLevel = 8;
     sf::RenderWindow window(sf::VideoMode(1600, 900), "ShootEmUp", sf::Style::Close | sf::Style::Titlebar, windowSettings);
     window.setKeyRepeatEnabled(false);
-    window.setFramerateLimit(FPS);
+    window.setVerticalSyncEnabled(true); // Rendering follows the display. The simulation ticks at FPS regardless
 
     SfTextAtHome hitText(font, WHITE, "Pichuun", 40, { 1000, 500 }, true, false, true, true);
     FadeText hitFade(hitText, 0, 1);
 
-    PatternManager manager;
+    PatternManager manager(seed);
+    FrameProfiler profiler;
+    manager.setProfiler(&profiler);
     GameScreen gameScreen(&manager, &hitFade, playerTexture, enemyTexture);
 
     sfClockAtHome fpsTimer;
     int fpsCounter = 0;
-    Pattern* generalBullets = new Pattern();
-    addTestBullets(generalBullets);
-
-    manager.addPattern(generalBullets);
-    manager.addPattern(new Bowap({ 400, 400 }, 8, 30, 6));
-    manager.addPattern(new QedRipples({ 400, 200 }, 80, 0.75, 3));
-    manager.addPattern(new FlyingSaucer({ 400, 250 }, 40, 0.35, 2));
-    manager.addPattern(new GengetsuTime({ 400, 200 }, 48, 10, 10));
-    manager.addPattern(new WindGod({ 400, 300 }, 0.3, 4));
-    manager.addPattern(new MercuryPoison({ 400, 200 }, 32, 3, 2.5));
-    manager.addPattern(new SeamlessCeiling({ 400, 200 }, 4, 2, 3));
-    manager.deactivateAllPatterns();
+    addStandardPatterns(manager);
+    if (!statePath.empty()) {
+        if (!gameScreen.loadState(statePath)) {
+            cout << "Failed to load state file " << statePath << "\n";
+            return -1;
+        }
+        cout << "Loaded state from " << statePath << " with seed " << manager.getSeed() << "\n";
+    }
 
     sf::CircleShape* cursor = new sf::CircleShape(15.f, 3); // Triangle shaped cursor
     cursor->rotate(90.f);
-    vector<string> menuText = { "Test", "BOWAP", "QED", "UFO", "GRT", "MOF", "HGP", "SCOKJ"};
+    vector<string> menuText = PATTERNNAMES;
     ClickableMenu danmaku(font, WHITE, menuText, 30, {850, 200}, 30, *cursor);
 
     sfClockAtHome bulletTimer;
     int bulletCounter = 0;
+    sf::Clock tickClock;
+    float tickAccumulator = 0; // Seconds of real time not yet simulated
     SfTextAtHome fpsText(font, WHITE, "60", 20, FPSTEXTPOS);
+#ifdef SHOOTEMUP_ALLOCTRACK
+    SfTextAtHome allocText(font, WHITE, "", 20, ALLOCTEXTPOS);
+    long long allocFrames = 0, allocFramesWithAllocations = 0; // Tracker totals when allocText was last set
+#endif
+    ProfilerOverlay profilerOverlay(&profiler, font);
+    SimulationThread* simulation = pipelined ? new SimulationThread(&gameScreen, &manager, recorder) : nullptr;
+    int hitCount = 0; // Hits already shown from pipelined snapshots
+    // Pattern commands from the menu and keys. Ignored while replaying, since the log has its own
+    auto sendCommand = [&](char type, int value) {
+        if (replay)
+            return;
+        if (simulation) {
+            if (!simulation->sendCommand(type, value))
+                cout << "Simulation is too far behind, dropped command " << int(type) << "\n";
+        }
+        else {
+            manager.applyCommand(type, value);
+            if (recorder)
+                recorder->addCommand(type, value);
+        }
+    };
     while (window.isOpen())
     {
+        profiler.markFrame();
+        ALLOC_END_FRAME();
         // Read fps
         if (fpsTimer.getTimeSeconds() > 1) {
+            ALLOC_SCOPE(ALLOCUI);
             fpsTimer.restart();
             fpsText.setString(to_string(fpsCounter));
             fpsCounter = 0;
+#ifdef SHOOTEMUP_ALLOCTRACK
+            // Frames of the last second that allocated, and what the last frame allocated
+            const AllocFrameStats& lastFrame = AllocTracker::getLastFrame();
+            allocText.setString(to_string(AllocTracker::getFramesWithAllocations() - allocFramesWithAllocations) + "/" +
+                to_string(AllocTracker::getFrameCount() - allocFrames) + " alloc " + to_string(lastFrame.allocations) + " " + to_string(lastFrame.bytes) + "B");
+            allocFrames = AllocTracker::getFrameCount();
+            allocFramesWithAllocations = AllocTracker::getFramesWithAllocations();
+#endif
         }
         fpsCounter++;
-        gameScreen.update();
+        if (simulation)
+            simulation->setInput(PlayerInput::readKeyboard());
+        else {
+            // Run as many fixed ticks as real time has passed. After a long stall, drop the backlog instead of trying to catch up forever
+            tickAccumulator += tickClock.restart().asSeconds();
+            PhaseTimer updateTimer(profiler.getStages());
+            int ticks = 0;
+            while (tickAccumulator >= TICKSECONDS && ticks < MAXTICKSPERFRAME) {
+                if (replay) {
+                    bool hit = false;
+                    if (!replay->playTick(gameScreen, manager, hit)) {
+                        cout << "Replay finished after " << replay->getTick() << " ticks\n";
+                        if (replay->getFirstDivergedTick() >= 0)
+                            cout << "State diverged from the log at tick " << replay->getFirstDivergedTick() << "\n";
+                        window.close();
+                        break;
+                    }
+                    if (hit)
+                        hitFade.restart();
+                }
+                else {
+                    PlayerInput input = PlayerInput::readKeyboard();
+                    if (gameScreen.simulate(input))
+                        hitFade.restart();
+                    if (recorder)
+                        recorder->recordTick(input, gameScreen.getChecksum());
+                }
+                tickAccumulator -= TICKSECONDS;
+                ticks++;
+            }
+            if (ticks > 0)
+                updateTimer.lap(UPDATESTAGE); // Every tick of the frame as one sample
+            if (ticks == MAXTICKSPERFRAME)
+                tickAccumulator = min(tickAccumulator, TICKSECONDS);
+        }
         sf::Event event;
         bool menuClicked = false;
         while (window.pollEvent(event))
@@ -100,15 +211,26 @@ int main(){
                 window.close();
                 break;
             case sf::Event::KeyPressed:
-                if (event.key.code >= 26 && event.key.code <= 35) {
-                    manager.deactivateAllPatterns();
-                    if (event.key.code - 26 < manager.getPatternCount()) {
-                        manager[event.key.code - 26]->setActive(true);
-                    }   
-                }
+                if (event.key.code >= 26 && event.key.code <= 35)
+                    sendCommand(SELECTPATTERNCOMMAND, event.key.code - 26);
 
-                else if (event.key.code == sf::Keyboard::Space) 
-                    manager.rotateAllBullets(30);
+                else if (event.key.code == sf::Keyboard::Space)
+                    sendCommand(ROTATEBULLETSCOMMAND, 30);
+                else if (event.key.code == sf::Keyboard::F3)
+                    profilerOverlay.toggle();
+                else if (event.key.code == sf::Keyboard::F5 || event.key.code == sf::Keyboard::F9) {
+                    // The simulation thread owns the state while pipelined, and input logs cannot jump to a saved state
+                    if (simulation || recorder || replay)
+                        cout << "States can only be saved and loaded without --pipelined, --record, or --replay\n";
+                    else if (event.key.code == sf::Keyboard::F5)
+                        cout << (gameScreen.saveState(STATEFILEPATH) ? "Saved state to " : "Failed to save state to ") << STATEFILEPATH << "\n";
+                    else
+                        cout << (gameScreen.loadState(STATEFILEPATH) ? "Loaded state from " : "Failed to load state from ") << STATEFILEPATH << "\n";
+                }
+                else if (event.key.code == sf::Keyboard::F4) {
+                    if (TRACE_WRITE(TRACEFILEPATH))
+                        cout << "Wrote trace to " << TRACEFILEPATH << "\n";
+                }
                 else if (event.key.code == sf::Keyboard::Z) {
                     break;
                 }
@@ -118,23 +240,55 @@ int main(){
                 danmaku.onMouseMove(event.mouseMove.x, event.mouseMove.y);
                 break;
             case sf::Event::MouseButtonPressed:
-                if (danmaku.onMouseClick(event.mouseButton.x, event.mouseButton.y)) {
-                    manager.deactivateAllPatterns();
-                    manager[danmaku.getCursorPos()]->setActive(true); // Index 0 is generalBullets
-                }
+                if (danmaku.onMouseClick(event.mouseButton.x, event.mouseButton.y)) // Index 0 is generalBullets
+                    sendCommand(SELECTPATTERNCOMMAND, danmaku.getCursorPos());
                 break;
             default:
                 break;
             }
         }
+        if (simulation) {
+            // Draw the newest finished tick, interpolated by how long ago it finished
+            const FrameSnapshot* snapshot = simulation->getLatestSnapshot();
+            float sinceTick = chrono::duration<float>(chrono::steady_clock::now() - snapshot->tickTime).count();
+            gameScreen.setSnapshot(snapshot, min(sinceTick / TICKSECONDS, 1.f));
+            if (snapshot->hitCount != hitCount) {
+                hitCount = snapshot->hitCount;
+                hitFade.restart();
+            }
+        }
+        else
+            manager.setInterpolation(tickAccumulator / TICKSECONDS);
+        profilerOverlay.update();
+        PhaseTimer stageTimer(profiler.getStages());
         window.clear();
-        window.draw(gameScreen);
+        {
+            TRACE_SCOPE("draw gameScreen");
+            ALLOC_SCOPE(ALLOCRENDER);
+            window.draw(gameScreen);
+        }
         window.draw(fpsText);
+#ifdef SHOOTEMUP_ALLOCTRACK
+        window.draw(allocText);
+#endif
         window.draw(danmaku);
+        window.draw(profilerOverlay);
         hitFade.drawAnimation(window);
-        window.display();
+        stageTimer.lap(DRAWSTAGE); // Every draw, so the display stage is only the buffer swap
+        {
+            TRACE_SCOPE("display");
+            window.display();
+        }
+        stageTimer.lap(DISPLAYSTAGE);
 
     }
+    delete simulation; // Stop simulating before the game screen and patterns are destroyed
+    delete recorder;
+    delete replay;
+    if (TRACE_WRITE(TRACEFILEPATH))
+        cout << "Wrote trace to " << TRACEFILEPATH << "\n";
+    if (ALLOC_WRITE_REPORT(ALLOCREPORTFILEPATH, manager.getPatternCount()))
+        cout << "Wrote allocation report to " << ALLOCREPORTFILEPATH << "\n";
 
     return 0;
 }
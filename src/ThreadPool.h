@@ -0,0 +1,160 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <memory>
+#include "Constants.h"
+#include "AllocTracker.h"
+using namespace Constants;
+
+// Fixed set of worker threads that run parallel loops split into chunks.
+// Every thread has its own queue of chunks. A thread runs its newest chunk first and, when its queue is empty,
+// steals the oldest chunk from another queue. A thread waiting for its loop to finish keeps running chunks,
+// so loops can be nested: a pattern updated on one thread can split its bullets across the others.
+class ThreadPool {
+	// A range of iterations of one parallel loop
+	struct Chunk {
+		const function<void(int, int)>* body;
+		int begin, end;
+		atomic<int>* remaining; // Chunks of the loop that have not finished
+#ifdef SHOOTEMUP_ALLOCTRACK
+		AllocTracker::Context allocContext; // Allocations in the chunk count against whatever queued it
+#endif
+	};
+	// Chunks in [front, chunks.size()). Emptied with clear so the storage is reused instead of freed and reallocated
+	struct ChunkQueue {
+		mutex lock;
+		vector<Chunk> chunks;
+		int front = 0;
+	};
+	vector<thread> workers;
+	vector<unique_ptr<ChunkQueue>> queues; // Queue 0 is shared by threads outside the pool. Worker i uses queue i + 1
+	atomic<int> queuedChunks;
+	mutex sleepLock;
+	condition_variable chunkQueued;
+	bool stopping;
+
+	// The pool and queue of the current thread. Threads outside any pool use queue 0
+	static pair<ThreadPool*, int>& currentWorker() {
+		static thread_local pair<ThreadPool*, int> worker(nullptr, 0);
+		return worker;
+	}
+	int getQueueIndex() {
+		return currentWorker().first == this ? currentWorker().second : 0;
+	}
+	// Take the newest chunk of a queue, or steal the oldest chunk of any other queue
+	bool takeChunk(int queueIndex, Chunk& chunk) {
+		for (int i = 0; i < queues.size(); i++) {
+			ChunkQueue& queue = *queues[(queueIndex + i) % queues.size()];
+			lock_guard<mutex> lock(queue.lock);
+			if (queue.front == queue.chunks.size())
+				continue;
+			if (i == 0) {
+				chunk = queue.chunks.back();
+				queue.chunks.pop_back();
+			}
+			else
+				chunk = queue.chunks[queue.front++];
+			if (queue.front == queue.chunks.size()) {
+				queue.chunks.clear();
+				queue.front = 0;
+			}
+			queuedChunks--;
+			return true;
+		}
+		return false;
+	}
+	void runChunk(const Chunk& chunk) {
+		{
+#ifdef SHOOTEMUP_ALLOCTRACK
+			AllocScope allocScope(chunk.allocContext);
+#endif
+			(*chunk.body)(chunk.begin, chunk.end);
+		}
+		(*chunk.remaining)--; // Last use of the chunk. The loop may return as soon as this reaches zero
+	}
+	void workerLoop(int queueIndex) {
+		currentWorker() = { this, queueIndex };
+		Chunk chunk;
+		while (true) {
+			if (takeChunk(queueIndex, chunk)) {
+				runChunk(chunk);
+				continue;
+			}
+			unique_lock<mutex> lock(sleepLock);
+			chunkQueued.wait(lock, [&] { return stopping || queuedChunks > 0; });
+			if (stopping)
+				return;
+		}
+	}
+public:
+	// Defaults to one worker per extra hardware thread
+	ThreadPool(int threadCount = max(int(thread::hardware_concurrency()) - 1, 0)) {
+		queuedChunks = 0;
+		stopping = false;
+		for (int i = 0; i <= threadCount; i++)
+			queues.push_back(unique_ptr<ChunkQueue>(new ChunkQueue()));
+		for (int i = 0; i < threadCount; i++)
+			workers.push_back(thread(&ThreadPool::workerLoop, this, i + 1));
+	}
+	~ThreadPool() {
+		{
+			lock_guard<mutex> lock(sleepLock);
+			stopping = true;
+		}
+		chunkQueued.notify_all();
+		for (thread& worker : workers)
+			worker.join();
+	}
+	// Run body over [0, count) split into ranges of at most chunkSize and return once all of them are done.
+	// Ranges must not depend on each other. Runs on the calling thread alone if the loop fits in one chunk
+	void parallelFor(int count, int chunkSize, const function<void(int, int)>& body) {
+		if (workers.empty() || count <= chunkSize) {
+			if (count > 0)
+				body(0, count);
+			return;
+		}
+		int chunkCount = (count + chunkSize - 1) / chunkSize;
+		atomic<int> remaining(chunkCount);
+		int queueIndex = getQueueIndex();
+#ifdef SHOOTEMUP_ALLOCTRACK
+		AllocTracker::Context allocContext = AllocTracker::getContext();
+#endif
+		{
+			ChunkQueue& queue = *queues[queueIndex];
+			lock_guard<mutex> lock(queue.lock);
+			for (int begin = 0; begin < count; begin += chunkSize) {
+				queue.chunks.push_back({ &body, begin, min(begin + chunkSize, count), &remaining });
+#ifdef SHOOTEMUP_ALLOCTRACK
+				queue.chunks.back().allocContext = allocContext;
+#endif
+			}
+			queuedChunks += chunkCount;
+		}
+		{
+			lock_guard<mutex> lock(sleepLock); // Workers cannot be between checking for chunks and sleeping
+		}
+		chunkQueued.notify_all();
+		// Help until this loop is done. This may also run chunks of other loops
+		Chunk chunk;
+		while (remaining > 0) {
+			if (takeChunk(queueIndex, chunk))
+				runChunk(chunk);
+			else
+				this_thread::yield();
+		}
+	}
+	// Run task(0) to task(count - 1) across the pool, one iteration per chunk
+	void parallelFor(int count, const function<void(int)>& task) {
+		parallelFor(count, 1, [&task](int begin, int end) {
+			for (int i = begin; i < end; i++)
+				task(i);
+		});
+	}
+	int getThreadCount() {
+		return workers.size() + 1;
+	}
+};
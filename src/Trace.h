@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Constants.h"
+using namespace std;
+using namespace Constants;
+
+// File to record timed spans of the simulation and rendering and write them as Chrome trace JSON,
+// which chrome://tracing and Perfetto can open. Only compiled in when SHOOTEMUP_TRACE is defined:
+// TRACE_SCOPE(name) times the rest of the enclosing block, TRACE_SCOPE_DETAIL(name, detail) adds a detail
+// such as a pattern name, and TRACE_WRITE(path) writes every recorded span. Names and details must be string
+// literals or otherwise outlive the recorder. Without SHOOTEMUP_TRACE the macros compile to nothing
+
+// One finished span. Fields are relaxed atomics so a trace can be written while other threads keep recording
+struct TraceSpan {
+	atomic<const char*> name, detail;
+	atomic<long long> start, duration; // Nanoseconds since the recorder was created
+};
+
+// Ring buffer of the latest spans of one thread. Only its own thread records into it
+struct TraceBuffer {
+	unique_ptr<TraceSpan[]> spans;
+	atomic<long long> recorded; // Spans recorded so far. The newest is at (recorded - 1) % TRACEBUFFERSPANS
+	int threadId;
+	TraceBuffer(int threadId) : spans(new TraceSpan[TRACEBUFFERSPANS]) {
+		recorded = 0;
+		this->threadId = threadId;
+	}
+	void add(const char* name, const char* detail, long long start, long long duration) {
+		long long index = recorded.load(memory_order_relaxed);
+		TraceSpan& span = spans[index % TRACEBUFFERSPANS];
+		span.name.store(name, memory_order_relaxed);
+		span.detail.store(detail, memory_order_relaxed);
+		span.start.store(start, memory_order_relaxed);
+		span.duration.store(duration, memory_order_relaxed);
+		recorded.store(index + 1, memory_order_release);
+	}
+};
+
+// Owns every thread's buffer. The lock is only taken when a thread records its first span and when writing
+class TraceRecorder {
+	mutex lock;
+	vector<unique_ptr<TraceBuffer>> buffers;
+	chrono::steady_clock::time_point epoch;
+
+	TraceRecorder() {
+		epoch = chrono::steady_clock::now();
+	}
+	// Write a string as a JSON string literal
+	static void writeString(ofstream& file, const char* text) {
+		file << '"';
+		for (; *text; text++) {
+			if (*text == '"' || *text == '\\')
+				file << '\\';
+			file << *text;
+		}
+		file << '"';
+	}
+public:
+	static TraceRecorder& get() {
+		static TraceRecorder recorder;
+		return recorder;
+	}
+	long long now() {
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+	}
+	// The calling thread's buffer, created the first time the thread records
+	TraceBuffer& getThreadBuffer() {
+		static thread_local TraceBuffer* buffer = nullptr;
+		if (!buffer) {
+			lock_guard<mutex> guard(lock);
+			buffers.push_back(unique_ptr<TraceBuffer>(new TraceBuffer(buffers.size())));
+			buffer = buffers.back().get();
+		}
+		return *buffer;
+	}
+	// Write every span still in the buffers as Chrome trace JSON. Returns false if the file cannot be opened
+	bool write(const string& path) {
+		ofstream file(path);
+		if (!file)
+			return false;
+		lock_guard<mutex> guard(lock);
+		file << fixed << setprecision(3); // Microseconds with nanosecond digits
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		for (const unique_ptr<TraceBuffer>& buffer : buffers) {
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"args\":{\"name\":\"thread " << buffer->threadId << "\"}}";
+			first = false;
+			long long recorded = buffer->recorded.load(memory_order_acquire);
+			for (long long i = max(0LL, recorded - TRACEBUFFERSPANS); i < recorded; i++) {
+				const TraceSpan& span = buffer->spans[i % TRACEBUFFERSPANS];
+				const char* detail = span.detail.load(memory_order_relaxed);
+				file << ",\n{\"name\":";
+				writeString(file, span.name.load(memory_order_relaxed));
+				file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"ts\":" << span.start.load(memory_order_relaxed) / 1000.0
+					<< ",\"dur\":" << span.duration.load(memory_order_relaxed) / 1000.0;
+				if (detail) {
+					file << ",\"args\":{\"detail\":";
+					writeString(file, detail);
+					file << "}";
+				}
+				file << "}";
+			}
+		}
+		file << "\n]}\n";
+		return true;
+	}
+};
+
+// Records the time from construction to the end of the enclosing block
+class TraceScope {
+	const char* name;
+	const char* detail;
+	long long start;
+public:
+	TraceScope(const char* name, const char* detail = nullptr) {
+		this->name = name;
+		this->detail = detail;
+		start = TraceRecorder::get().now();
+	}
+	~TraceScope() {
+		TraceRecorder& recorder = TraceRecorder::get();
+		recorder.getThreadBuffer().add(name, detail, start, recorder.now() - start);
+	}
+};
+
+#ifdef SHOOTEMUP_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_SCOPE_DETAIL(name, detail) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, detail)
+#define TRACE_WRITE(path) TraceRecorder::get().write(path)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_DETAIL(name, detail) ((void)0)
+#define TRACE_WRITE(path) false
+#endif